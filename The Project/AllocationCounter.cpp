@@ -0,0 +1,80 @@
+#include "AllocationCounter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace gps {
+
+    // plain globals with constant initialization, ready before any constructor allocates
+    static std::atomic<unsigned long long> allocationCount(0);
+    static std::atomic<unsigned long long> freeCount(0);
+    static std::atomic<unsigned long long> allocatedBytes(0);
+
+    static void* countedAllocate(std::size_t size) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+        //malloc(0) may return NULL, new must not
+        return std::malloc(size > 0 ? size : 1);
+    }
+
+    static void countedFree(void* memory) {
+        if (memory == NULL) {
+            return;
+        }
+        freeCount.fetch_add(1, std::memory_order_relaxed);
+        std::free(memory);
+    }
+
+    AllocationCounts allocationCounts() {
+        AllocationCounts counts;
+        counts.allocations = allocationCount.load(std::memory_order_relaxed);
+        counts.frees = freeCount.load(std::memory_order_relaxed);
+        counts.bytes = allocatedBytes.load(std::memory_order_relaxed);
+        return counts;
+    }
+}
+
+void* operator new(std::size_t size) {
+    void* memory = gps::countedAllocate(size);
+    if (memory == NULL) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return gps::countedAllocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return gps::countedAllocate(size);
+}
+
+void operator delete(void* memory) noexcept {
+    gps::countedFree(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    gps::countedFree(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    gps::countedFree(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    gps::countedFree(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+    gps::countedFree(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+    gps::countedFree(memory);
+}
@@ -0,0 +1,20 @@
+#ifndef AllocationCounter_hpp
+#define AllocationCounter_hpp
+
+namespace gps {
+
+    // Heap activity through the global operator new and delete since the program started,
+    // on every thread. C libraries and the driver allocating with malloc are not seen.
+    struct AllocationCounts
+    {
+        unsigned long long allocations;
+        unsigned long long frees;
+        unsigned long long bytes;
+    };
+
+    // The replaced operators only add a relaxed atomic increment to every allocation, so
+    // they stay in all builds and frame loop checks can run on the shipped executable
+    AllocationCounts allocationCounts();
+}
+
+#endif /* AllocationCounter_hpp */
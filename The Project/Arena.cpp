@@ -0,0 +1,88 @@
+#include "Arena.hpp"
+
+#include <algorithm>
+#include <new>
+
+namespace gps {
+
+    Arena frameArena;
+
+    Arena::Arena(size_t blockSize) : blockSize(blockSize), current(0), offset(0), allocationCount(0), bytesAllocated(0), blocksAllocated(0) {
+    }
+
+    Arena::~Arena() {
+        for (size_t i = 0; i < blocks.size(); i++) {
+            ::operator delete(blocks[i].memory);
+        }
+    }
+
+    void* Arena::allocate(size_t size, size_t alignment) {
+        allocationCount++;
+        bytesAllocated += size;
+
+        if (current < blocks.size()) {
+            Block& block = blocks[current];
+            size_t start = (offset + alignment - 1) & ~(alignment - 1);
+            if (start + size <= block.size) {
+                offset = start + size;
+                return block.memory + start;
+            }
+
+            //blocks kept by rewind() are used again before any new one is taken
+            while (++current < blocks.size()) {
+                if (size <= blocks[current].size) {
+                    offset = size;
+                    return blocks[current].memory;
+                }
+            }
+        }
+
+        //a new block, big enough for requests larger than the usual block size;
+        //operator new memory is aligned for any fundamental type
+        Block block;
+        block.size = std::max(blockSize, size);
+        block.memory = static_cast<unsigned char*>(::operator new(block.size));
+        blocks.push_back(block);
+        blocksAllocated++;
+
+        current = blocks.size() - 1;
+        offset = size;
+        return block.memory;
+    }
+
+    void Arena::reset() {
+        //one regular block is kept, the rest only existed for unusually big loads
+        size_t kept = 0;
+        for (size_t i = 0; i < blocks.size(); i++) {
+            if (kept == 0 && blocks[i].size == blockSize) {
+                blocks[kept++] = blocks[i];
+            }
+            else {
+                ::operator delete(blocks[i].memory);
+            }
+        }
+        blocks.resize(kept);
+
+        rewind();
+    }
+
+    void Arena::rewind() {
+        current = 0;
+        offset = 0;
+        allocationCount = 0;
+        bytesAllocated = 0;
+        blocksAllocated = 0;
+    }
+
+    size_t Arena::getAllocationCount() {
+        return allocationCount;
+    }
+
+    size_t Arena::getBytesAllocated() {
+        return bytesAllocated;
+    }
+
+    size_t Arena::getBlocksAllocated() {
+        return blocksAllocated;
+    }
+}
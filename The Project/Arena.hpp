@@ -0,0 +1,102 @@
+#ifndef Arena_hpp
+#define Arena_hpp
+
+#include <cstddef>
+#include <vector>
+
+namespace gps {
+
+    // Monotonic arena: every allocation is a pointer bump inside a large block and nothing
+    // is freed on its own. reset() releases everything at once and keeps the first block
+    // for the next use. Not thread safe, use one arena per thread.
+    class Arena
+    {
+    public:
+        static const size_t DEFAULT_BLOCK_SIZE = 1 << 20;
+
+        explicit Arena(size_t blockSize = DEFAULT_BLOCK_SIZE);
+        ~Arena();
+
+        void* allocate(size_t size, size_t alignment);
+
+        //invalidates everything allocated so far
+        void reset();
+
+        //invalidates everything allocated so far but keeps every block, for arenas that
+        //serve about the same load over and over and must not touch the heap once warm
+        void rewind();
+
+        //allocations served since the last reset, each one a heap allocation avoided
+        size_t getAllocationCount();
+        size_t getBytesAllocated();
+        //heap blocks the arena itself took since the last reset
+        size_t getBlocksAllocated();
+
+    private:
+        struct Block {
+            unsigned char* memory;
+            size_t size;
+        };
+
+        size_t blockSize;
+        std::vector<Block> blocks;
+        //block allocations are served from, blocks past it are free
+        size_t current;
+        //bump position in the current block
+        size_t offset;
+
+        size_t allocationCount;
+        size_t bytesAllocated;
+        size_t blocksAllocated;
+
+        Arena(const Arena&);
+        Arena& operator=(const Arena&);
+    };
+
+    // Standard allocator drawing from an arena, deallocate does nothing
+    template <typename T>
+    class ArenaAllocator
+    {
+    public:
+        typedef T value_type;
+
+        explicit ArenaAllocator(Arena& arena) : arena(&arena) {
+        }
+
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {
+        }
+
+        T* allocate(size_t count) {
+            return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T*, size_t) {
+        }
+
+        template <typename U>
+        bool operator==(const ArenaAllocator<U>& other) const {
+            return arena == other.arena;
+        }
+
+        template <typename U>
+        bool operator!=(const ArenaAllocator<U>& other) const {
+            return arena != other.arena;
+        }
+
+    private:
+        template <typename U>
+        friend class ArenaAllocator;
+
+        Arena* arena;
+    };
+
+    template <typename T>
+    using ArenaVector = std::vector<T, ArenaAllocator<T> >;
+
+    // Transient render data of the frame being drawn. Only used on the thread owning the
+    // GL context, rewound at the start of every presented frame.
+    extern Arena frameArena;
+}
+
+#endif /* Arena_hpp */
@@ -0,0 +1,135 @@
+#include "AssetStreamer.hpp"
+#include "GLDebug.hpp"
+#include "JobSystem.hpp"
+#include "Trace.hpp"
+
+namespace gps {
+
+    AssetStreamer::AssetStreamer() : stopping(false), residentCount(0) {
+    }
+
+    AssetStreamer::~AssetStreamer() {
+        stop();
+    }
+
+    void AssetStreamer::start(SharedContext uploadContext, const std::vector<StreamRequest>& requests) {
+        this->uploadContext = uploadContext;
+        this->requests = requests;
+        stopping = false;
+        loader = std::thread(&AssetStreamer::loaderLoop, this);
+    }
+
+    void AssetStreamer::stop() {
+        stopping = true;
+        if (loader.joinable()) {
+            loader.join();
+        }
+
+        //fences of uploads nobody will use anymore
+        for (size_t i = 0; i < uploaded.size(); i++) {
+            pending.push_back(uploaded[i]);
+        }
+        uploaded.clear();
+        for (size_t i = 0; i < pending.size(); i++) {
+            glDeleteSync(pending[i].fence);
+        }
+        pending.clear();
+    }
+
+    unsigned int AssetStreamer::poll() {
+        {
+            std::lock_guard<std::mutex> lock(uploadedMutex);
+            pending.insert(pending.end(), uploaded.begin(), uploaded.end());
+            uploaded.clear();
+        }
+
+        unsigned int madeResident = 0;
+        for (size_t i = 0; i < pending.size();) {
+            //a zero timeout only asks, it never waits
+            GLenum status = glClientWaitSync(pending[i].fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+                i++;
+                continue;
+            }
+
+            glDeleteSync(pending[i].fence);
+            pending[i].model->SetupVertexArrays();
+            madeResident++;
+
+            pending[i] = pending.back();
+            pending.pop_back();
+        }
+
+        residentCount += madeResident;
+        return madeResident;
+    }
+
+    bool AssetStreamer::isFinished() {
+        return residentCount == requests.size();
+    }
+
+    Model3D* AssetStreamer::takeImported() {
+        std::lock_guard<std::mutex> lock(importedMutex);
+        if (imported.empty()) {
+            return NULL;
+        }
+        Model3D* model = imported.back();
+        imported.pop_back();
+        return model;
+    }
+
+    void AssetStreamer::loaderLoop() {
+        trace::setThreadName("Asset loader");
+        uploadContext.makeCurrent();
+        //the window's context does not report errors of this one
+        if (glDebug.isInstalled()) {
+            glDebug.install();
+        }
+
+        JobSystem& jobs = JobSystem::shared();
+        AssetStreamer* self = this;
+
+        //every model is parsed by its own job, this thread only makes GL calls
+        Job* imports = jobs.create([] {});
+        for (size_t i = 0; i < requests.size(); i++) {
+            const StreamRequest* request = &requests[i];
+            //background, so that the threads drawing frames never run a piece of an import
+            jobs.run(jobs.create([self, request] {
+                if (!self->stopping) {
+                    request->model->Import(request->path);
+                }
+                std::lock_guard<std::mutex> lock(self->importedMutex);
+                self->imported.push_back(request->model);
+            }, imports, JOB_BACKGROUND));
+        }
+        jobs.run(imports);
+
+        size_t handled = 0;
+        while (handled < requests.size()) {
+            Model3D* model = takeImported();
+            if (model == NULL) {
+                //the imports are this thread's jobs, with no workers nobody else runs them
+                if (!jobs.runPendingJob()) {
+                    std::this_thread::yield();
+                }
+                continue;
+            }
+            handled++;
+
+            if (stopping) {
+                continue;
+            }
+
+            model->UploadResources();
+            Upload upload = { model, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) };
+            //a fence only signals once it reached the GPU, other contexts never flush this one
+            glFlush();
+
+            std::lock_guard<std::mutex> lock(uploadedMutex);
+            uploaded.push_back(upload);
+        }
+        jobs.wait(imports);
+
+        uploadContext.release();
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef AssetStreamer_hpp
+#define AssetStreamer_hpp
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "Model3D.hpp"
+#include "Window.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace gps {
+
+    // A model to stream in and the file it is imported from
+    struct StreamRequest
+    {
+        Model3D* model;
+        std::string path;
+    };
+
+    // Loads models in the background while the scene is drawn. A loader thread owns a
+    // context sharing objects with the drawing context: models are imported as jobs, their
+    // buffers and textures uploaded on the loader context as soon as each import is done,
+    // and every upload is followed by a fence. The drawing context polls the fences and
+    // makes a model resident (vertex arrays, which are not shared) once its fence signaled,
+    // so drawing never waits for a load.
+    class AssetStreamer
+    {
+    public:
+        AssetStreamer();
+        ~AssetStreamer();
+
+        //uploadContext must share objects with the drawing context and not be current anywhere
+        void start(SharedContext uploadContext, const std::vector<StreamRequest>& requests);
+
+        //on the drawing context, once per frame: makes the models whose uploads completed
+        //resident without blocking, returns how many became resident
+        unsigned int poll();
+
+        //every requested model is resident
+        bool isFinished();
+
+        //abandons the models not imported yet and joins the loader thread
+        void stop();
+
+    private:
+        // An upload on the loader context, not yet known to be complete
+        struct Upload {
+            Model3D* model;
+            GLsync fence;
+        };
+
+        SharedContext uploadContext;
+        std::vector<StreamRequest> requests;
+        std::thread loader;
+        std::atomic<bool> stopping;
+
+        //filled by the import jobs, drained by the loader thread
+        std::mutex importedMutex;
+        std::vector<Model3D*> imported;
+
+        //filled by the loader thread, drained by poll()
+        std::mutex uploadedMutex;
+        std::vector<Upload> uploaded;
+
+        //owned by the drawing context
+        std::vector<Upload> pending;
+        size_t residentCount;
+
+        void loaderLoop();
+        Model3D* takeImported();
+    };
+}
+
+#endif /* AssetStreamer_hpp */
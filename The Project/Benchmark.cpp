@@ -0,0 +1,307 @@
+#include "Benchmark.hpp"
+#include "BenchmarkSuite.hpp"
+#include "Camera.hpp"
+#include "Frustum.hpp"
+#include "InputQueue.hpp"
+#include "JobSystem.hpp"
+#include "TransformStore.hpp"
+#include "TransformKernel.hpp"
+#include "Simd.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace gps {
+    namespace benchmark {
+
+        typedef std::chrono::high_resolution_clock Clock;
+
+        static double elapsedMs(Clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+
+        static glm::mat4 staticInstanceMatrix(size_t i) {
+            glm::mat4 tempModel = glm::translate(glm::mat4(1.0f), glm::vec3((float)(i % 1000) * 4.0f, 0.5f, (float)(i / 1000) * 4.0f));
+            tempModel = glm::rotate(tempModel, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+            tempModel = glm::scale(tempModel, glm::vec3(0.05f, 0.05f, 0.05f));
+            return tempModel;
+        }
+
+        static glm::mat4 animatedInstanceMatrix(size_t i, int frame) {
+            glm::mat4 tempModel = glm::translate(glm::mat4(1.0f), glm::vec3((float)i, 0.5f + 0.01f * frame, 0.0f));
+            tempModel = glm::rotate(tempModel, glm::radians((float)frame), glm::vec3(0.0f, 1.0f, 0.0f));
+            return tempModel;
+        }
+
+        void transformStore(size_t instanceCount) {
+            const int frames = 100;
+            const size_t animatedCount = 4;
+
+            std::cout << "Transform store benchmark: " << instanceCount << " static + "
+                << animatedCount << " animated instances, " << frames << " frames" << std::endl;
+
+            //old approach: every matrix rebuilt with translate/rotate/scale on every frame
+            std::vector<glm::mat4> matrices(instanceCount + animatedCount);
+            Clock::time_point start = Clock::now();
+            for (int frame = 0; frame < frames; frame++) {
+                for (size_t i = 0; i < instanceCount; i++) {
+                    matrices[i] = staticInstanceMatrix(i);
+                }
+                for (size_t i = 0; i < animatedCount; i++) {
+                    matrices[instanceCount + i] = animatedInstanceMatrix(i, frame);
+                }
+                sink = matrices[frame % matrices.size()][3][0];
+            }
+            double rebuildMs = elapsedMs(start) / frames;
+
+            //transform store: statics computed once, only the animated ones afterwards
+            TransformStore store;
+            start = Clock::now();
+            TransformId root = store.create(glm::mat4(1.0f));
+            for (size_t i = 0; i < instanceCount; i++) {
+                store.create(staticInstanceMatrix(i), root);
+            }
+            std::vector<TransformId> animated;
+            for (size_t i = 0; i < animatedCount; i++) {
+                animated.push_back(store.create(animatedInstanceMatrix(i, 0), root));
+            }
+            store.update();
+            double setupMs = elapsedMs(start);
+
+            size_t recomputed = 0;
+            start = Clock::now();
+            for (int frame = 0; frame < frames; frame++) {
+                for (size_t i = 0; i < animatedCount; i++) {
+                    store.setLocal(animated[i], animatedInstanceMatrix(i, frame));
+                }
+                recomputed += store.update();
+                sink = store.getWorld(animated[frame % animatedCount])[3][0];
+            }
+            double storeMs = elapsedMs(start) / frames;
+
+            std::cout << "  rebuild all matrices : " << rebuildMs << " ms/frame" << std::endl;
+            std::cout << "  transform store setup: " << setupMs << " ms (once)" << std::endl;
+            std::cout << "  transform store      : " << storeMs << " ms/frame, "
+                << recomputed / frames << " matrices recomputed per frame" << std::endl;
+        }
+    
+        //largest absolute difference between two matrix arrays
+        template <typename Matrix>
+        static float maxDifference(const std::vector<Matrix>& a, const std::vector<Matrix>& b, int columns, int rows) {
+            float difference = 0.0f;
+            for (size_t i = 0; i < a.size(); i++) {
+                for (int c = 0; c < columns; c++) {
+                    for (int r = 0; r < rows; r++) {
+                        difference = std::max(difference, std::fabs(a[i][c][r] - b[i][c][r]));
+                    }
+                }
+            }
+            return difference;
+        }
+
+        static void viewTransforms(size_t instanceCount, const glm::mat4& view) {
+            const int frames = 50;
+
+            std::vector<glm::mat4> models(instanceCount);
+            for (size_t i = 0; i < instanceCount; i++) {
+                models[i] = staticInstanceMatrix(i);
+            }
+            std::vector<glm::mat4> modelViews(instanceCount);
+            std::vector<glm::mat3> normalMatrices(instanceCount);
+
+            //what renderObject did: one glm call chain per object
+            std::vector<glm::mat4> glmModelViews(instanceCount);
+            std::vector<glm::mat3> glmNormalMatrices(instanceCount);
+            Clock::time_point start = Clock::now();
+            for (int frame = 0; frame < frames; frame++) {
+                for (size_t i = 0; i < instanceCount; i++) {
+                    glmModelViews[i] = view * models[i];
+                    glmNormalMatrices[i] = glm::mat3(glm::inverseTranspose(view * models[i]));
+                }
+                sink = glmNormalMatrices[frame % instanceCount][0][0];
+            }
+            double glmMs = elapsedMs(start) / frames;
+
+            start = Clock::now();
+            for (int frame = 0; frame < frames; frame++) {
+                computeViewTransformsScalar(view, models.data(), instanceCount, modelViews.data(), normalMatrices.data());
+                sink = normalMatrices[frame % instanceCount][0][0];
+            }
+            double scalarMs = elapsedMs(start) / frames;
+
+            start = Clock::now();
+            for (int frame = 0; frame < frames; frame++) {
+                computeViewTransforms(view, models.data(), instanceCount, modelViews.data(), normalMatrices.data());
+                sink = normalMatrices[frame % instanceCount][0][0];
+            }
+            double batchedMs = elapsedMs(start) / frames;
+
+            //both sides compute the same unnormalized inverse transpose
+            float modelViewError = maxDifference(modelViews, glmModelViews, 4, 4);
+            float normalError = maxDifference(normalMatrices, glmNormalMatrices, 3, 3);
+
+            std::cout << "  " << instanceCount << " instances: glm per object " << glmMs << " ms, scalar kernel "
+                << scalarMs << " ms, batched kernel " << batchedMs << " ms (" << glmMs / batchedMs
+                << "x), max error " << std::max(modelViewError, normalError) << std::endl;
+        }
+
+        void viewTransforms() {
+            const size_t instanceCounts[] = { 1000, 10000, 100000 };
+            glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 5.5f), glm::vec3(0.0f, 2.0f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+#if defined(GPS_SIMD_AVX2)
+            const char* path = "AVX2";
+#elif defined(GPS_SIMD_SSE)
+            const char* path = "SSE";
+#else
+            const char* path = "scalar";
+#endif
+            std::cout << "View transform benchmark (" << path << " kernel), ms per frame" << std::endl;
+            for (size_t i = 0; i < sizeof(instanceCounts) / sizeof(instanceCounts[0]); i++) {
+                viewTransforms(instanceCounts[i], view);
+            }
+        }
+    
+        //a few microseconds of dependent floating point work
+        static float smallTask(size_t seed) {
+            float value = (float)seed;
+            for (int i = 0; i < 2000; i++) {
+                value = value * 0.999f + 0.5f;
+            }
+            return value;
+        }
+
+        void jobScaling(unsigned int maxThreads) {
+            const int frames = 20;
+            const size_t instanceCount = 200000;
+            const size_t smallJobCount = 2000;
+            unsigned int threadCount = maxThreads > 0 ? maxThreads : std::max(1u, std::thread::hardware_concurrency());
+
+            std::vector<glm::mat4> models(instanceCount);
+            for (size_t i = 0; i < instanceCount; i++) {
+                models[i] = staticInstanceMatrix(i);
+            }
+            std::vector<glm::mat4> modelViews(instanceCount);
+            std::vector<glm::mat3> normalMatrices(instanceCount);
+            std::vector<BoundingBox> bounds(instanceCount);
+            BoundingBox unitBox = { glm::vec3(-1.0f), glm::vec3(1.0f) };
+            glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 5.5f), glm::vec3(0.0f, 2.0f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+            std::vector<float> results(smallJobCount);
+
+            std::cout << "Job system scaling benchmark: " << instanceCount << " objects of frame preparation, "
+                << smallJobCount << " small child jobs, ms per frame" << std::endl;
+
+            double framePrepBaseline = 0.0;
+            double smallJobsBaseline = 0.0;
+            for (unsigned int threads = 1; threads <= threadCount; threads++) {
+                JobSystem jobs(threads - 1);
+
+                Clock::time_point start = Clock::now();
+                for (int frame = 0; frame < frames; frame++) {
+                    jobs.parallelFor(instanceCount, 1024, [&](size_t begin, size_t end) {
+                        for (size_t i = begin; i < end; i++) {
+                            bounds[i] = unitBox.transformed(models[i]);
+                        }
+                        computeViewTransforms(view, &models[begin], end - begin, &modelViews[begin], &normalMatrices[begin]);
+                    });
+                }
+                double framePrepMs = elapsedMs(start) / frames;
+
+                float* output = results.data();
+                start = Clock::now();
+                for (int frame = 0; frame < frames; frame++) {
+                    Job* root = jobs.create([] {});
+                    for (size_t i = 0; i < smallJobCount; i++) {
+                        jobs.run(jobs.create([output, i] { output[i] = smallTask(i); }, root));
+                    }
+                    jobs.run(root);
+                    jobs.wait(root);
+                    sink = output[frame];
+                }
+                double smallJobsMs = elapsedMs(start) / frames;
+
+                if (threads == 1) {
+                    framePrepBaseline = framePrepMs;
+                    smallJobsBaseline = smallJobsMs;
+                }
+                std::cout << "  " << threads << " thread(s): frame preparation " << framePrepMs << " ms ("
+                    << framePrepBaseline / framePrepMs << "x), small jobs " << smallJobsMs << " ms ("
+                    << smallJobsBaseline / smallJobsMs << "x)" << std::endl;
+            }
+        }
+
+        //what every event cost before the queue: a camera rotation, a new view matrix and
+        //its inverse transpose (the uniform upload is not counted, there is no context here)
+        static float applyCursorEvent(Camera& camera, double x, double y) {
+            camera.rotate((float)(y * 0.1), (float)(x * 0.1 - 90.0));
+            glm::mat4 view = camera.getViewMatrix();
+            glm::mat3 lightDirMatrix = glm::mat3(glm::inverseTranspose(view));
+            return lightDirMatrix[0][0];
+        }
+
+        void inputEvents() {
+            const int frames = 600;
+            const double frameRate = 60.0;
+            const double eventRates[] = { 125.0, 500.0, 1000.0, 4000.0, 8000.0, 16000.0 };
+
+            std::cout << "Input event stress test: " << frames << " frames at " << frameRate
+                << " fps, cursor events spread over each frame, us per frame" << std::endl;
+
+            Camera camera(glm::vec3(0.0f, 10.0f, 3.0f), glm::vec3(0.0f, 10.0f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+            InputQueue queue;
+            InputFrame frame;
+
+            for (size_t r = 0; r < sizeof(eventRates) / sizeof(eventRates[0]); r++) {
+                int eventsPerFrame = (int)(eventRates[r] / frameRate + 0.5);
+
+                //old approach: the whole update in every callback
+                Clock::time_point start = Clock::now();
+                float result = 0.0f;
+                for (int f = 0; f < frames; f++) {
+                    for (int e = 0; e < eventsPerFrame; e++) {
+                        result += applyCursorEvent(camera, f + e * 0.01, e * 0.01);
+                    }
+                }
+                double perEventUs = elapsedMs(start) * 1000.0 / frames;
+                sink = result;
+
+                //callbacks push, the frame drains once and updates the camera once
+                double pushUs = 0.0;
+                double drainUs = 0.0;
+                for (int f = 0; f < frames; f++) {
+                    start = Clock::now();
+                    for (int e = 0; e < eventsPerFrame; e++) {
+                        InputEvent event = { INPUT_CURSOR, 0, 0, f + e * 0.01, e * 0.01, f / frameRate };
+                        queue.push(event);
+                    }
+                    pushUs += elapsedMs(start) * 1000.0;
+
+                    start = Clock::now();
+                    queue.drain(frame);
+                    if (frame.cursorMoved) {
+                        result += applyCursorEvent(camera, frame.cursorX, frame.cursorY);
+                    }
+                    drainUs += elapsedMs(start) * 1000.0;
+                }
+                sink = result;
+
+                std::cout << "  " << eventRates[r] << " Hz (" << eventsPerFrame << " events/frame): per event update "
+                    << perEventUs << " us, queued callbacks " << pushUs / frames << " us + frame update "
+                    << drainUs / frames << " us" << std::endl;
+            }
+
+            if (queue.getDropped() > 0) {
+                std::cout << "  " << queue.getDropped() << " events dropped" << std::endl;
+            }
+        }
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef Benchmark_hpp
+#define Benchmark_hpp
+
+#include <cstddef>
+
+namespace gps {
+
+    // CPU benchmarks of engine subsystems, selected from the command line
+    // (see printUsage in main.cpp). They do not need an OpenGL context.
+    namespace benchmark {
+
+        //per frame cost of the transform store with instanceCount static and a few animated
+        //transforms, compared with rebuilding every matrix the way the old gen*() functions did
+        void transformStore(size_t instanceCount);
+
+        //batched model-view and normal matrices (SIMD and scalar kernels) against one glm
+        //inverseTranspose per object, at 1k, 10k and 100k instances
+        void viewTransforms();
+
+        //job system throughput with 1 to maxThreads threads (0 = hardware threads):
+        //a data parallel frame preparation load and many small dependent jobs
+        void jobScaling(unsigned int maxThreads);
+
+        //input stress test: per frame cost of mouse events at growing event rates, applied
+        //one by one the way the old callbacks did and coalesced through the input queue
+        void inputEvents();
+    }
+}
+
+#endif /* Benchmark_hpp */
@@ -0,0 +1,272 @@
+#include "BenchmarkSuite.hpp"
+#include "Camera.hpp"
+#include "Json.hpp"
+#include "Model3D.hpp"
+#include "SkyBox.hpp"
+#include "tiny_obj_loader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#endif
+
+namespace gps {
+    namespace benchmark {
+
+        typedef std::chrono::steady_clock Clock;
+
+        volatile float sink;
+
+        // Swallows what the benchmarked code logs
+        class NullBuffer : public std::streambuf {
+        protected:
+            virtual int overflow(int c) {
+                return c;
+            }
+        };
+
+        static double elapsedNs(Clock::time_point start) {
+            return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        }
+
+        //user and kernel time of all threads of the process; clock() is wall time on Windows
+        static double processCpuNs() {
+#ifdef _WIN32
+            FILETIME creation, exit, kernel, user;
+            GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+            ULARGE_INTEGER kernelTime, userTime;
+            kernelTime.LowPart = kernel.dwLowDateTime;
+            kernelTime.HighPart = kernel.dwHighDateTime;
+            userTime.LowPart = user.dwLowDateTime;
+            userTime.HighPart = user.dwHighDateTime;
+            //100 ns units
+            return (double)(kernelTime.QuadPart + userTime.QuadPart) * 100.0;
+#else
+            return (double)clock() * (1000000000.0 / CLOCKS_PER_SEC);
+#endif
+        }
+
+        struct EngineAccess {
+            static void readOBJ(Model3D& model, const std::string& path) {
+                model.ReadOBJ(path, path.substr(0, path.find_last_of('/')) + "/");
+            }
+
+            static void textures(Model3D& model, std::vector<std::string>& paths) {
+                for (size_t i = 0; i < model.loadedTextures.size(); i++) {
+                    paths.push_back(model.loadedTextures[i].path);
+                }
+            }
+
+            static void readTexture(Model3D& model, const std::string& path) {
+                Model3D::TextureImage image = model.ReadTextureFromFile(path.c_str());
+                Model3D::FreeTextureImage(image);
+            }
+
+            static GLuint loadSkyBoxTextures(SkyBox& skyBox, const std::vector<const GLchar*>& faces) {
+                return skyBox.LoadSkyBoxTextures(faces);
+            }
+        };
+
+        void Suite::add(const std::string& name, std::function<void()> operation, double items) {
+            Case benchmarkCase;
+            benchmarkCase.name = name;
+            benchmarkCase.operation = operation;
+            benchmarkCase.items = items;
+            benchmarkCase.ran = false;
+            cases.push_back(benchmarkCase);
+        }
+
+        void Suite::measure(Case& benchmarkCase) {
+            //the first run warms caches and sizes the samples
+            Clock::time_point start = Clock::now();
+            benchmarkCase.operation();
+            double firstNs = elapsedNs(start);
+            unsigned long long perSample = std::max(1ULL, (unsigned long long)(SAMPLE_MS * 1000000.0 / std::max(firstNs, 1.0)));
+
+            std::vector<double> samples;
+            double totalNs = 0.0;
+            double cpuStartNs = processCpuNs();
+            while (samples.size() < MIN_SAMPLES || (totalNs < MIN_TOTAL_MS * 1000000.0 && samples.size() < MAX_SAMPLES)) {
+                start = Clock::now();
+                for (unsigned long long i = 0; i < perSample; i++) {
+                    benchmarkCase.operation();
+                }
+                double sampleNs = elapsedNs(start);
+                totalNs += sampleNs;
+                samples.push_back(sampleNs / perSample);
+            }
+
+            double cpuNs = processCpuNs() - cpuStartNs;
+
+            std::sort(samples.begin(), samples.end());
+            benchmarkCase.ran = true;
+            benchmarkCase.iterations = perSample * samples.size();
+            benchmarkCase.samples = (unsigned int)samples.size();
+            benchmarkCase.medianNs = samples[samples.size() / 2];
+            benchmarkCase.minNs = samples[0];
+            benchmarkCase.meanNs = totalNs / benchmarkCase.iterations;
+            benchmarkCase.cpuNs = cpuNs / benchmarkCase.iterations;
+        }
+
+        bool Suite::selected(const Case& benchmarkCase, const std::string& filter) {
+            return filter.empty() || benchmarkCase.name.find(filter) != std::string::npos;
+        }
+
+        void Suite::run(const std::string& filter) {
+            std::cout << "Benchmark suite: median / min / mean per operation" << std::endl;
+
+            int nameWidth = 0;
+            for (size_t i = 0; i < cases.size(); i++) {
+                if (selected(cases[i], filter)) {
+                    nameWidth = std::max(nameWidth, (int)cases[i].name.size());
+                }
+            }
+
+            NullBuffer nullBuffer;
+            for (size_t i = 0; i < cases.size(); i++) {
+                Case& benchmarkCase = cases[i];
+                if (!selected(benchmarkCase, filter)) {
+                    continue;
+                }
+
+                std::streambuf* out = std::cout.rdbuf(&nullBuffer);
+                std::streambuf* err = std::cerr.rdbuf(&nullBuffer);
+                measure(benchmarkCase);
+                std::cout.rdbuf(out);
+                std::cerr.rdbuf(err);
+
+                char line[512];
+                snprintf(line, sizeof(line), "  %-*s %12.0f / %12.0f / %12.0f ns, %llu iterations",
+                    nameWidth, benchmarkCase.name.c_str(), benchmarkCase.medianNs, benchmarkCase.minNs, benchmarkCase.meanNs, benchmarkCase.iterations);
+                std::cout << line;
+                if (benchmarkCase.items > 0.0) {
+                    std::cout << ", " << benchmarkCase.items / benchmarkCase.medianNs * 1000.0 << " M items/s";
+                }
+                std::cout << std::endl;
+            }
+        }
+
+        bool Suite::writeJson(const std::string& path) {
+            FILE* file = fopen(path.c_str(), "w");
+            if (file == NULL) {
+                return false;
+            }
+
+            json::beginReport(file);
+            fprintf(file, ",\n  \"benchmarks\": [");
+            bool first = true;
+            for (size_t i = 0; i < cases.size(); i++) {
+                const Case& benchmarkCase = cases[i];
+                if (!benchmarkCase.ran) {
+                    continue;
+                }
+                fprintf(file, "%s\n    {\"name\": ", first ? "" : ",");
+                json::writeString(file, benchmarkCase.name);
+                fprintf(file, ", \"run_type\": \"iteration\", \"iterations\": %llu, \"repetitions\": %u, "
+                    "\"real_time\": %.3f, \"cpu_time\": %.3f, \"min_time\": %.3f, \"mean_time\": %.3f, \"time_unit\": \"ns\"",
+                    benchmarkCase.iterations, benchmarkCase.samples, benchmarkCase.medianNs, benchmarkCase.cpuNs,
+                    benchmarkCase.minNs, benchmarkCase.meanNs);
+                if (benchmarkCase.items > 0.0) {
+                    fprintf(file, ", \"items_per_second\": %.3f", benchmarkCase.items / benchmarkCase.medianNs * 1e9);
+                }
+                fprintf(file, "}");
+                first = false;
+            }
+            fprintf(file, "\n  ]\n}\n");
+            return fclose(file) == 0;
+        }
+
+        //an .obj of vertex lines only, so that parsing it is mostly float parsing
+        static std::string floatOnlyObj(size_t vertexCount) {
+            std::ostringstream obj;
+            obj.precision(7);
+            for (size_t i = 0; i < vertexCount; i++) {
+                float x = (float)(i % 977) * 0.731f - 300.0f;
+                float y = (float)(i % 13) * 1.0e-3f;
+                float z = (float)i * 12.5f;
+                obj << "v " << x << ' ' << y << ' ' << z << '\n';
+            }
+            return obj.str();
+        }
+
+        static void sumVertex(void* user, float x, float y, float z, float w) {
+            *static_cast<float*>(user) += x + y + z + w;
+        }
+
+        void addEngineCases(Suite& suite, const std::vector<std::string>& modelPaths, const std::vector<const GLchar*>& skyBoxFaces) {
+            //textures are found by parsing every model once
+            std::set<std::string> texturePaths;
+            for (size_t i = 0; i < modelPaths.size(); i++) {
+                std::string path = modelPaths[i];
+                suite.add("ReadOBJ/" + path, [path] {
+                    Model3D model;
+                    EngineAccess::readOBJ(model, path);
+                });
+
+                std::vector<std::string> textures;
+                {
+                    Model3D model;
+                    NullBuffer nullBuffer;
+                    std::streambuf* out = std::cout.rdbuf(&nullBuffer);
+                    EngineAccess::readOBJ(model, path);
+                    std::cout.rdbuf(out);
+                    EngineAccess::textures(model, textures);
+                }
+                texturePaths.insert(textures.begin(), textures.end());
+            }
+
+            for (std::set<std::string>::const_iterator i = texturePaths.begin(); i != texturePaths.end(); ++i) {
+                std::string path = *i;
+                suite.add("ReadTextureFromFile/" + path, [path] {
+                    Model3D model;
+                    EngineAccess::readTexture(model, path);
+                });
+            }
+
+            const size_t vertexCount = 100000;
+            std::string obj = floatOnlyObj(vertexCount);
+            suite.add("tinyobj/ParseFloats/300000", [obj] {
+                float sum = 0.0f;
+                tinyobj::callback_t callback;
+                callback.vertex_cb = sumVertex;
+                std::istringstream stream(obj);
+                std::string err;
+                tinyobj::LoadObjWithCallback(stream, callback, &sum, NULL, &err);
+                sink = sum;
+            }, vertexCount * 3.0);
+
+            const int cameraCalls = 1000;
+            suite.add("Camera/rotate/1000", [] {
+                static Camera camera(glm::vec3(0.0f, 10.0f, 3.0f), glm::vec3(0.0f, 10.0f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+                for (int i = 0; i < cameraCalls; i++) {
+                    camera.rotate((float)(i % 170) - 85.0f, (float)i * 0.36f);
+                }
+                sink = camera.getViewMatrix()[0][0];
+            }, cameraCalls);
+            suite.add("Camera/getViewMatrix/1000", [] {
+                static Camera camera(glm::vec3(0.0f, 10.0f, 3.0f), glm::vec3(0.0f, 10.0f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+                float sum = 0.0f;
+                for (int i = 0; i < cameraCalls; i++) {
+                    sum += camera.getViewMatrix()[3][i % 3];
+                }
+                sink = sum;
+            }, cameraCalls);
+
+            std::vector<const GLchar*> faces = skyBoxFaces;
+            suite.add("SkyBox/LoadFaces", [faces] {
+                SkyBox skyBox;
+                GLuint texture = EngineAccess::loadSkyBoxTextures(skyBox, faces);
+                glDeleteTextures(1, &texture);
+            });
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef BenchmarkSuite_hpp
+#define BenchmarkSuite_hpp
+
+#include <GL/glew.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace gps {
+    namespace benchmark {
+
+        //benchmarked code stores a result here, so that the optimizer cannot drop the work
+        extern volatile float sink;
+
+        // Microbenchmarks of the loading and per frame hot paths, run by --bench-suite.
+        // Every case repeats an operation in samples of about SAMPLE_MS until it ran for
+        // MIN_TOTAL_MS (at least MIN_SAMPLES, at most MAX_SAMPLES samples) and reports the
+        // median, min and mean time per operation, and the mean process CPU time (cpu_time).
+        // Results can be written as JSON in the layout of Google Benchmark, so its compare
+        // tools work across commits.
+        class Suite
+        {
+        public:
+            static const unsigned int MIN_SAMPLES = 3;
+            static const unsigned int MAX_SAMPLES = 30;
+            static constexpr double SAMPLE_MS = 20.0;
+            static constexpr double MIN_TOTAL_MS = 500.0;
+
+            //items is the work done by one operation (floats parsed, matrices built, ...),
+            //reported as items per second when not 0
+            void add(const std::string& name, std::function<void()> operation, double items = 0.0);
+
+            //runs the cases whose name contains filter (all when empty) and prints a line per case;
+            //what the benchmarked code prints to std::cout and std::cerr is dropped meanwhile
+            void run(const std::string& filter);
+
+            bool writeJson(const std::string& path);
+
+        private:
+            struct Case {
+                std::string name;
+                std::function<void()> operation;
+                double items;
+                bool ran;
+                unsigned long long iterations;
+                unsigned int samples;
+                double medianNs;
+                double minNs;
+                double meanNs;
+                //process CPU time per operation, workers included
+                double cpuNs;
+            };
+
+            std::vector<Case> cases;
+
+            static bool selected(const Case& benchmarkCase, const std::string& filter);
+            void measure(Case& benchmarkCase);
+        };
+
+        // Grants the suite the private loading steps of Model3D and SkyBox
+        struct EngineAccess;
+
+        //ReadOBJ of every model and ReadTextureFromFile (decode and flip) of every texture they
+        //use, tinyobj float parsing, Camera::rotate and getViewMatrix, SkyBox face loading;
+        //needs a current context for the texture uploads and the teardown of the models
+        void addEngineCases(Suite& suite, const std::vector<std::string>& modelPaths, const std::vector<const GLchar*>& skyBoxFaces);
+    }
+}
+
+#endif /* BenchmarkSuite_hpp */
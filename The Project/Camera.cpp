@@ -53,6 +53,10 @@ namespace gps {
         this->cameraUpDirection = glm::vec3(0.0f, 1.0f, 0.0f);
     }
 
+    glm::vec3 Camera::getPosition() {
+        return this->cameraPosition;
+    }
+
     //update the camera internal parameters following a camera rotate event
     //yaw - camera rotation around the y axis
     //pitch - camera rotation around the x axis
@@ -25,6 +25,8 @@ namespace gps {
         void rotate(float pitch, float yaw);
 
         void reset();
+
+        glm::vec3 getPosition();
         
     private:
         glm::vec3 cameraPosition;
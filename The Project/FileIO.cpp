@@ -0,0 +1,32 @@
+#include "FileIO.hpp"
+#include "Trace.hpp"
+
+#include <cstdio>
+
+namespace gps {
+
+    bool readFile(const std::string& path, std::vector<char>& contents) {
+        TraceScope trace("Read file", "io", path.c_str());
+        contents.clear();
+        FILE* file = fopen(path.c_str(), "rb");
+        if (file == NULL) {
+            return false;
+        }
+
+        bool ok = fseek(file, 0, SEEK_END) == 0;
+        long size = ok ? ftell(file) : -1;
+        ok = size >= 0 && fseek(file, 0, SEEK_SET) == 0;
+        if (ok) {
+            contents.resize((size_t)size);
+            ok = fread(contents.data(), 1, contents.size(), file) == contents.size();
+        }
+        fclose(file);
+        return ok;
+    }
+
+    MemoryStreamBuffer::MemoryStreamBuffer(const char* data, size_t size) {
+        //the get area is never written through
+        char* begin = const_cast<char*>(data);
+        setg(begin, begin, begin + size);
+    }
+}
@@ -0,0 +1,23 @@
+#ifndef FileIO_hpp
+#define FileIO_hpp
+
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    // Reads a whole file into memory in one go, traced as "Read file" (category "io") so
+    // that the startup report can tell file I/O from the parsing or decoding that follows;
+    // false when the file cannot be read
+    bool readFile(const std::string& path, std::vector<char>& contents);
+
+    // Read only stream buffer over memory, to hand file contents to parsers taking a std::istream
+    class MemoryStreamBuffer : public std::streambuf
+    {
+    public:
+        MemoryStreamBuffer(const char* data, size_t size);
+    };
+}
+
+#endif /* FileIO_hpp */
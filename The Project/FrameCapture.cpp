@@ -0,0 +1,292 @@
+#include "FrameCapture.hpp"
+#include "MemoryTracker.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+    #define popen _popen
+    #define pclose _pclose
+    #define PIPE_WRITE_MODE "wb"
+#else
+    //POSIX pipes have no text mode and glibc rejects "wb"
+    #define PIPE_WRITE_MODE "w"
+#endif
+
+namespace gps {
+
+    typedef std::chrono::steady_clock Clock;
+
+    static double secondsSince(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    FrameCapture::FrameCapture() : output(CAPTURE_PPM_SEQUENCE), pipe(NULL), width(0), height(0), capturing(false),
+        oldestSlot(0), slotsInFlight(0), framesIssued(0), queueHead(0), queueCount(0), stopping(false),
+        framesWritten(0), framesDropped(0), stalls(0), writeErrors(0), captureSeconds(0.0), writeSeconds(0.0) {
+    }
+
+    FrameCapture::~FrameCapture() {
+        //the pixel buffers need the context, stop() must have run; only the writer is left to join
+        if (writer.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(framesMutex);
+                stopping = true;
+            }
+            framesQueued.notify_one();
+            writer.join();
+        }
+    }
+
+    bool FrameCapture::start(CAPTURE_OUTPUT output, const std::string& target, int width, int height, unsigned int ringSize) {
+        this->output = output;
+        this->target = target;
+        this->width = width;
+        this->height = height;
+
+        if (output == CAPTURE_PIPE) {
+            pipe = popen(target.c_str(), PIPE_WRITE_MODE);
+            if (pipe == NULL) {
+                std::cerr << "Capture: could not start " << target << std::endl;
+                return false;
+            }
+        }
+
+        size_t frameSize = (size_t)width * height * 4;
+        slots.resize(ringSize > 0 ? ringSize : 1);
+        for (size_t i = 0; i < slots.size(); i++) {
+            glGenBuffers(1, &slots[i].buffer);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, frameSize, NULL, GL_STREAM_READ);
+            MemoryTracker::shared().trackBuffer(slots[i].buffer, frameSize, "Frame capture", "readback buffer");
+            slots[i].fence = 0;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        //everything the capture needs is allocated here, capturing a frame does not allocate
+        frames.resize(WRITER_FRAMES);
+        queuedFrames.reset(new size_t[WRITER_FRAMES]);
+        freeFrames.reserve(WRITER_FRAMES);
+        for (size_t i = 0; i < frames.size(); i++) {
+            frames[i].pixels.resize(frameSize);
+            MemoryTracker::shared().trackCpu(MEMORY_CPU_IMAGE, &frames[i].pixels[0], frameSize, "Frame capture", "frame for the writer");
+            freeFrames.push_back(i);
+        }
+
+        stopping = false;
+        writer = std::thread(&FrameCapture::writerLoop, this);
+        capturing = true;
+        return true;
+    }
+
+    bool FrameCapture::isCapturing() {
+        return capturing;
+    }
+
+    void FrameCapture::capture(GLuint framebuffer, unsigned long long frame) {
+        Clock::time_point start = Clock::now();
+
+        //whatever finished since the last frame, then the slot about to be reused at any cost
+        collect(false);
+        if (slotsInFlight == slots.size()) {
+            stalls++;
+            collect(true);
+        }
+        //the GPU did not finish the oldest copy within the wait, its slot is still in use
+        if (slotsInFlight == slots.size()) {
+            std::lock_guard<std::mutex> lock(framesMutex);
+            framesDropped++;
+            captureSeconds += secondsSince(start);
+            return;
+        }
+
+        Slot& slot = slots[(oldestSlot + slotsInFlight) % slots.size()];
+        slot.frame = frame;
+        framesIssued++;
+        slotsInFlight++;
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        glReadBuffer(framebuffer == 0 ? GL_BACK : GL_COLOR_ATTACHMENT0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        //into the buffer object, so the call returns as soon as the copy is queued
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        captureSeconds += secondsSince(start);
+    }
+
+    //reads back the slots whose copy completed, oldest first so frames stay in order;
+    //with wait the oldest one is waited for up to a second; a slot whose fence failed is
+    //freed with its frame dropped
+    void FrameCapture::collect(bool wait) {
+        while (slotsInFlight > 0) {
+            Slot& slot = slots[oldestSlot];
+            GLenum status = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000 : 0);
+            if (status == GL_TIMEOUT_EXPIRED) {
+                return;
+            }
+            wait = false;
+
+            if (status == GL_WAIT_FAILED) {
+                std::lock_guard<std::mutex> lock(framesMutex);
+                framesDropped++;
+            }
+            else {
+                readBack(slot);
+            }
+            glDeleteSync(slot.fence);
+            slot.fence = 0;
+            oldestSlot = (oldestSlot + 1) % slots.size();
+            slotsInFlight--;
+        }
+    }
+
+    void FrameCapture::readBack(Slot& slot) {
+        size_t frameIndex;
+        {
+            std::lock_guard<std::mutex> lock(framesMutex);
+            if (freeFrames.empty()) {
+                framesDropped++;
+                return;
+            }
+            frameIndex = freeFrames.back();
+            freeFrames.pop_back();
+        }
+
+        Frame& frame = frames[frameIndex];
+        frame.index = slot.frame;
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frame.pixels.size(), GL_MAP_READ_BIT);
+        if (pixels != NULL) {
+            memcpy(&frame.pixels[0], pixels, frame.pixels.size());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        {
+            std::lock_guard<std::mutex> lock(framesMutex);
+            if (pixels == NULL) {
+                framesDropped++;
+                freeFrames.push_back(frameIndex);
+                return;
+            }
+            queuedFrames[(queueHead + queueCount) % WRITER_FRAMES] = frameIndex;
+            queueCount++;
+        }
+        framesQueued.notify_one();
+    }
+
+    void FrameCapture::stop() {
+        if (!capturing) {
+            return;
+        }
+        capturing = false;
+
+        //the last frames are still on the GPU
+        while (slotsInFlight > 0) {
+            collect(true);
+        }
+        for (size_t i = 0; i < slots.size(); i++) {
+            MemoryTracker::shared().release(MEMORY_BUFFER, slots[i].buffer);
+            glDeleteBuffers(1, &slots[i].buffer);
+        }
+        slots.clear();
+
+        {
+            std::lock_guard<std::mutex> lock(framesMutex);
+            stopping = true;
+        }
+        framesQueued.notify_one();
+        writer.join();
+
+        for (size_t i = 0; i < frames.size(); i++) {
+            MemoryTracker::shared().releaseCpu(MEMORY_CPU_IMAGE, &frames[i].pixels[0]);
+        }
+        frames.clear();
+        freeFrames.clear();
+        queueHead = 0;
+        queueCount = 0;
+
+        if (pipe != NULL) {
+            pclose(pipe);
+            pipe = NULL;
+        }
+        printStats();
+    }
+
+    void FrameCapture::writerLoop() {
+        //one output row, converted to rgb24 and flipped to top down
+        std::vector<unsigned char> row((size_t)width * 3);
+
+        while (true) {
+            size_t frameIndex;
+            {
+                std::unique_lock<std::mutex> lock(framesMutex);
+                framesQueued.wait(lock, [this] { return stopping || queueCount > 0; });
+                if (queueCount == 0) {
+                    return;
+                }
+                frameIndex = queuedFrames[queueHead];
+                queueHead = (queueHead + 1) % WRITER_FRAMES;
+                queueCount--;
+            }
+
+            Clock::time_point start = Clock::now();
+            bool written = writeFrame(frames[frameIndex], row);
+            double seconds = secondsSince(start);
+
+            std::lock_guard<std::mutex> lock(framesMutex);
+            writeSeconds += seconds;
+            if (written) {
+                framesWritten++;
+            }
+            else {
+                writeErrors++;
+            }
+            freeFrames.push_back(frameIndex);
+        }
+    }
+
+    bool FrameCapture::writeFrame(const Frame& frame, std::vector<unsigned char>& row) {
+        FILE* file = pipe;
+        if (output == CAPTURE_PPM_SEQUENCE) {
+            char path[1024];
+            snprintf(path, sizeof(path), "%s/frame_%06llu.ppm", target.c_str(), frame.index);
+            file = fopen(path, "wb");
+            if (file == NULL) {
+                return false;
+            }
+            fprintf(file, "P6\n%d %d\n255\n", width, height);
+        }
+
+        bool written = true;
+        for (int y = height - 1; y >= 0 && written; y--) {
+            const unsigned char* source = &frame.pixels[(size_t)y * width * 4];
+            for (int x = 0; x < width; x++) {
+                row[x * 3 + 0] = source[x * 4 + 0];
+                row[x * 3 + 1] = source[x * 4 + 1];
+                row[x * 3 + 2] = source[x * 4 + 2];
+            }
+            written = fwrite(&row[0], 1, row.size(), file) == row.size();
+        }
+
+        if (output == CAPTURE_PPM_SEQUENCE) {
+            written = fclose(file) == 0 && written;
+        }
+        return written;
+    }
+
+    void FrameCapture::printStats() {
+        std::lock_guard<std::mutex> lock(framesMutex);
+        double issued = framesIssued > 0 ? (double)framesIssued : 1.0;
+        double written = framesWritten > 0 ? (double)framesWritten : 1.0;
+        std::cout << "Capture: " << framesIssued << " frames read back, " << framesWritten << " written, "
+            << framesDropped << " dropped, " << writeErrors << " write errors, " << stalls << " stalls; "
+            << captureSeconds / issued * 1000.0 << " ms per frame on the render thread, "
+            << writeSeconds / written * 1000.0 << " ms per frame on the writer" << std::endl;
+    }
+}
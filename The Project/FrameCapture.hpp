@@ -0,0 +1,104 @@
+#ifndef FrameCapture_hpp
+#define FrameCapture_hpp
+
+#include <GL/glew.h>
+
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace gps {
+
+    enum CAPTURE_OUTPUT {CAPTURE_PPM_SEQUENCE, CAPTURE_PIPE};
+
+    // Records the rendered frames without stalling the frame loop. Each frame is read into
+    // the next pixel buffer object of a ring and fenced; a buffer is mapped once its fence
+    // signaled, usually a frame or two later, its pixels copied into a preallocated frame
+    // and handed to a writer thread. When the writer falls behind frames are dropped rather
+    // than waited for. Output is a sequence of binary PPM files or raw rgb24 frames piped to
+    // a local encoder, e.g. ffmpeg -f rawvideo -pix_fmt rgb24 -s 1920x1080 -i - out.mp4
+    class FrameCapture
+    {
+    public:
+        static const unsigned int DEFAULT_RING_SIZE = 3;
+        //frames waiting for the writer before new ones are dropped
+        static const unsigned int WRITER_FRAMES = 4;
+
+        FrameCapture();
+        ~FrameCapture();
+
+        //target is the directory of the PPM files or the encoder command; false when it cannot be opened
+        bool start(CAPTURE_OUTPUT output, const std::string& target, int width, int height,
+            unsigned int ringSize = DEFAULT_RING_SIZE);
+
+        //on the context thread, after a frame was drawn into framebuffer and before the swap;
+        //frame names the file, its frame packet index as for the golden images
+        void capture(GLuint framebuffer, unsigned long long frame);
+
+        //reads back the frames still in flight, waits for the writer and closes the output
+        void stop();
+
+        bool isCapturing();
+
+        //counts and per frame cost since start
+        void printStats();
+
+    private:
+        // A pixel buffer object of the ring and the frame read into it
+        struct Slot {
+            GLuint buffer;
+            GLsync fence;
+            unsigned long long frame;
+        };
+
+        // Pixels on their way to the writer, bottom row first as OpenGL returns them
+        struct Frame {
+            std::vector<unsigned char> pixels;
+            unsigned long long index;
+        };
+
+        CAPTURE_OUTPUT output;
+        std::string target;
+        FILE* pipe;
+        int width;
+        int height;
+        bool capturing;
+
+        //owned by the context thread
+        std::vector<Slot> slots;
+        //oldest slot still in flight and how many are
+        size_t oldestSlot;
+        size_t slotsInFlight;
+        unsigned long long framesIssued;
+
+        //frames shared with the writer: free ones and a queue of filled ones, both by index
+        std::vector<Frame> frames;
+        std::mutex framesMutex;
+        std::condition_variable framesQueued;
+        std::vector<size_t> freeFrames;
+        std::unique_ptr<size_t[]> queuedFrames;
+        size_t queueHead;
+        size_t queueCount;
+        bool stopping;
+        std::thread writer;
+
+        //statistics
+        unsigned long long framesWritten;
+        unsigned long long framesDropped;
+        unsigned long long stalls;
+        unsigned long long writeErrors;
+        double captureSeconds;
+        double writeSeconds;
+
+        void collect(bool wait);
+        void readBack(Slot& slot);
+        void writerLoop();
+        bool writeFrame(const Frame& frame, std::vector<unsigned char>& row);
+    };
+}
+
+#endif /* FrameCapture_hpp */
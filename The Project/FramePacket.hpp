@@ -0,0 +1,66 @@
+#ifndef FramePacket_hpp
+#define FramePacket_hpp
+
+#include <glm/glm.hpp>
+
+#include "Frustum.hpp"
+#include "OcclusionCuller.hpp"
+
+#include <vector>
+
+namespace gps {
+
+    // Scene objects that survived culling for one render pass
+    struct PassVisibility
+    {
+        std::vector<unsigned int> objects;
+        unsigned int visibleCount;
+        unsigned int culledCount;
+        //objects of the main pass hidden behind occluders
+        unsigned int occludedCount;
+    };
+
+    // Snapshot of the simulated world for one frame, built once by the update stage.
+    // The shadow and main passes only read it, so both see exactly the same world.
+    // It holds everything rendering needs, so it can be drawn on another thread while
+    // the next one is built.
+    struct FramePacket
+    {
+        //counts simulated frames from 1, 0 means nothing was built yet
+        unsigned long long frameIndex;
+        //glfwGetTime() of the first input event this frame responds to, 0 without input
+        double inputTime;
+        //input events applied since the start, up to this frame
+        unsigned long long inputEvents;
+
+        //camera
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec3 cameraPosition;
+
+        //lights
+        glm::vec3 lightDirection;
+        glm::mat4 lightSpaceTrMatrix;
+        glm::mat3 lightDirMatrix;
+        glm::vec4 pointLightSource;
+
+        //world matrices and bounds, one per scene object in scene order
+        std::vector<glm::mat4> worldMatrices;
+        std::vector<BoundingBox> worldBounds;
+        //view * world and its normal matrix, computed in one batch for the main pass
+        std::vector<glm::mat4> modelViewMatrices;
+        std::vector<glm::mat3> normalMatrices;
+        glm::mat4 lightCubeMatrix;
+
+        //camera frustum and light frustum visibility
+        PassVisibility mainPass;
+        PassVisibility shadowPass;
+        OcclusionStats occlusion;
+        bool occlusionCulling;
+
+        //GL_FILL, GL_LINE or GL_POINT
+        unsigned int polygonMode;
+    };
+}
+
+#endif /* FramePacket_hpp */
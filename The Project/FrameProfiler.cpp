@@ -0,0 +1,309 @@
+#include "FrameProfiler.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace gps {
+
+    static const double OVERLAY_PIXELS_PER_MS = 20.0;
+    static const double OVERLAY_FRAME_BUDGET_MS = 1000.0 / 60.0;
+    static const int OVERLAY_BAR_HEIGHT = 6;
+    static const int OVERLAY_MARGIN = 8;
+    //weight of the newest frame in the overlay times
+    static const double RECENT_WEIGHT = 0.1;
+
+    static const char* OVERLAY_COLOR_NAMES[] = { "red", "green", "blue", "yellow", "magenta", "cyan", "orange", "white" };
+    static const GLfloat OVERLAY_COLORS[][3] = {
+        { 0.9f, 0.2f, 0.2f }, { 0.2f, 0.8f, 0.2f }, { 0.2f, 0.4f, 0.95f }, { 0.95f, 0.85f, 0.2f },
+        { 0.85f, 0.3f, 0.85f }, { 0.2f, 0.85f, 0.85f }, { 0.95f, 0.55f, 0.1f }, { 0.95f, 0.95f, 0.95f }
+    };
+    static const unsigned int OVERLAY_COLOR_COUNT = sizeof(OVERLAY_COLORS) / sizeof(OVERLAY_COLORS[0]);
+
+    void TimingStats::reset() {
+        count = 0;
+        sumMs = 0.0;
+        minMs = 0.0;
+        maxMs = 0.0;
+        memset(bins, 0, sizeof(bins));
+    }
+
+    void TimingStats::add(double ms) {
+        if (count == 0 || ms < minMs) {
+            minMs = ms;
+        }
+        if (ms > maxMs) {
+            maxMs = ms;
+        }
+        count++;
+        sumMs += ms;
+
+        //bin 0 holds everything up to 1 microsecond, the last one everything past 2^24
+        double microseconds = ms * 1000.0;
+        unsigned int bin = 0;
+        if (microseconds > 1.0) {
+            double octaves = std::log2(microseconds) * BINS_PER_OCTAVE;
+            bin = octaves < BINS - 2 ? (unsigned int)octaves + 1 : BINS - 1;
+        }
+        bins[bin]++;
+    }
+
+    double TimingStats::averageMs() const {
+        return count > 0 ? sumMs / count : 0.0;
+    }
+
+    double TimingStats::percentileMs(double fraction) const {
+        unsigned long long target = (unsigned long long)std::ceil(count * fraction);
+        unsigned long long seen = 0;
+        for (unsigned int i = 0; i < BINS; i++) {
+            seen += bins[i];
+            if (seen >= target && seen > 0) {
+                //the last bin has no upper edge, and no bin is narrower than the samples
+                double upperEdgeMs = std::exp2((double)i / BINS_PER_OCTAVE) / 1000.0;
+                if (i == BINS - 1 || upperEdgeMs > maxMs) {
+                    return maxMs;
+                }
+                return upperEdgeMs > minMs ? upperEdgeMs : minMs;
+            }
+        }
+        return maxMs;
+    }
+
+    FrameProfiler::FrameProfiler() : passCount(0), oldestFrame(0), framesInFlight(0), currentFrame(NULL),
+        initialized(false), framesProfiled(0), framesDropped(0) {
+    }
+
+    unsigned int FrameProfiler::addPass(const char* name) {
+        if (passCount == MAX_PASSES) {
+            return MAX_PASSES - 1;
+        }
+        Pass& pass = passes[passCount];
+        pass.name = name;
+        pass.cpu.reset();
+        pass.gpu.reset();
+        pass.cpuWindow.reset();
+        pass.gpuWindow.reset();
+        pass.cpuRecentMs = 0.0;
+        pass.gpuRecentMs = 0.0;
+        return passCount++;
+    }
+
+    const char* FrameProfiler::getPassName(unsigned int pass) {
+        return passes[pass].name;
+    }
+
+    void FrameProfiler::init() {
+        for (unsigned int i = 0; i < FRAME_RING; i++) {
+            glGenQueries(MAX_PASSES * 2, frames[i].queries);
+            memset(frames[i].issued, 0, sizeof(frames[i].issued));
+            frames[i].lastQuery = 0;
+        }
+        initialized = true;
+    }
+
+    void FrameProfiler::destroy() {
+        if (!initialized) {
+            return;
+        }
+        for (unsigned int i = 0; i < FRAME_RING; i++) {
+            glDeleteQueries(MAX_PASSES * 2, frames[i].queries);
+        }
+        initialized = false;
+    }
+
+    void FrameProfiler::beginFrame() {
+        if (!initialized) {
+            return;
+        }
+        while (framesInFlight > 0 && collect(false)) {
+        }
+        //the ring is full of frames the GPU has not reached yet: give up the oldest
+        if (framesInFlight == FRAME_RING) {
+            collect(true);
+        }
+
+        currentFrame = &frames[(oldestFrame + framesInFlight) % FRAME_RING];
+        memset(currentFrame->issued, 0, sizeof(currentFrame->issued));
+        currentFrame->lastQuery = 0;
+    }
+
+    void FrameProfiler::endFrame() {
+        if (currentFrame == NULL) {
+            return;
+        }
+        framesInFlight++;
+        framesProfiled++;
+        currentFrame = NULL;
+    }
+
+    void FrameProfiler::beginPass(unsigned int pass) {
+        passes[pass].cpuStart = Clock::now();
+        if (currentFrame != NULL) {
+            glQueryCounter(currentFrame->queries[pass * 2], GL_TIMESTAMP);
+        }
+    }
+
+    void FrameProfiler::endPass(unsigned int pass) {
+        Pass& p = passes[pass];
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - p.cpuStart).count();
+        p.cpu.add(ms);
+        p.cpuWindow.add(ms);
+        p.cpuRecentMs += (ms - p.cpuRecentMs) * RECENT_WEIGHT;
+
+        if (currentFrame != NULL) {
+            GLuint query = currentFrame->queries[pass * 2 + 1];
+            glQueryCounter(query, GL_TIMESTAMP);
+            currentFrame->issued[pass] = true;
+            currentFrame->lastQuery = query;
+        }
+    }
+
+    bool FrameProfiler::collect(bool drop) {
+        FrameQueries& frame = frames[oldestFrame];
+
+        //timestamps complete in order, the frame is done once its last query is
+        GLuint available = GL_TRUE;
+        if (frame.lastQuery != 0) {
+            glGetQueryObjectuiv(frame.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+        }
+        if (!available && !drop) {
+            return false;
+        }
+
+        if (available) {
+            for (unsigned int i = 0; i < passCount; i++) {
+                if (!frame.issued[i]) {
+                    continue;
+                }
+                GLuint64 begin = 0;
+                GLuint64 end = 0;
+                glGetQueryObjectui64v(frame.queries[i * 2], GL_QUERY_RESULT, &begin);
+                glGetQueryObjectui64v(frame.queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+                double ms = end > begin ? (end - begin) / 1000000.0 : 0.0;
+                passes[i].gpu.add(ms);
+                passes[i].gpuWindow.add(ms);
+                passes[i].gpuRecentMs += (ms - passes[i].gpuRecentMs) * RECENT_WEIGHT;
+            }
+        }
+        else {
+            framesDropped++;
+        }
+
+        oldestFrame = (oldestFrame + 1) % FRAME_RING;
+        framesInFlight--;
+        return true;
+    }
+
+    void FrameProfiler::reset() {
+        for (unsigned int i = 0; i < passCount; i++) {
+            passes[i].cpu.reset();
+            passes[i].gpu.reset();
+            passes[i].cpuWindow.reset();
+            passes[i].gpuWindow.reset();
+        }
+        framesProfiled = 0;
+        framesDropped = 0;
+    }
+
+    void FrameProfiler::printPasses(std::ostream& out, bool window) {
+        for (unsigned int i = 0; i < passCount; i++) {
+            const TimingStats& cpu = window ? passes[i].cpuWindow : passes[i].cpu;
+            const TimingStats& gpu = window ? passes[i].gpuWindow : passes[i].gpu;
+            out << "  " << passes[i].name << ": CPU " << cpu.minMs << " / " << cpu.averageMs() << " / "
+                << cpu.percentileMs(0.99) << " ms, GPU " << gpu.minMs << " / " << gpu.averageMs() << " / "
+                << gpu.percentileMs(0.99) << " ms" << std::endl;
+        }
+    }
+
+    void FrameProfiler::printStats(std::ostream& out) {
+        out << "Profiler (min / avg / p99 since the last report):" << std::endl;
+        printPasses(out, true);
+        for (unsigned int i = 0; i < passCount; i++) {
+            passes[i].cpuWindow.reset();
+            passes[i].gpuWindow.reset();
+        }
+    }
+
+    void FrameProfiler::printSummary(std::ostream& out) {
+        out << "Profiler: " << framesProfiled << " frames, " << framesDropped
+            << " without GPU times (min / avg / p99):" << std::endl;
+        printPasses(out, false);
+    }
+
+    void FrameProfiler::printPercentiles(std::ostream& out) {
+        out << "Profiler: " << framesProfiled << " frames, " << framesDropped
+            << " without GPU times (p50 / p95 / p99 / max):" << std::endl;
+        for (unsigned int i = 0; i < passCount; i++) {
+            const TimingStats& cpu = passes[i].cpu;
+            const TimingStats& gpu = passes[i].gpu;
+            out << "  " << passes[i].name << ": CPU " << cpu.percentileMs(0.5) << " / " << cpu.percentileMs(0.95) << " / "
+                << cpu.percentileMs(0.99) << " / " << cpu.maxMs << " ms, GPU " << gpu.percentileMs(0.5) << " / "
+                << gpu.percentileMs(0.95) << " / " << gpu.percentileMs(0.99) << " / " << gpu.maxMs << " ms" << std::endl;
+        }
+    }
+
+    bool FrameProfiler::exportCsv(const std::string& path) {
+        std::ofstream file(path.c_str());
+        if (!file) {
+            return false;
+        }
+        file << "pass,cpu_samples,cpu_min_ms,cpu_avg_ms,cpu_p99_ms,cpu_max_ms,"
+            << "gpu_samples,gpu_min_ms,gpu_avg_ms,gpu_p99_ms,gpu_max_ms" << std::endl;
+        for (unsigned int i = 0; i < passCount; i++) {
+            const TimingStats& cpu = passes[i].cpu;
+            const TimingStats& gpu = passes[i].gpu;
+            file << passes[i].name << ','
+                << cpu.count << ',' << cpu.minMs << ',' << cpu.averageMs() << ',' << cpu.percentileMs(0.99) << ',' << cpu.maxMs << ','
+                << gpu.count << ',' << gpu.minMs << ',' << gpu.averageMs() << ',' << gpu.percentileMs(0.99) << ',' << gpu.maxMs << std::endl;
+        }
+        return (bool)file;
+    }
+
+    void FrameProfiler::drawOverlay(GLuint framebuffer, int height) {
+        GLfloat clearColor[4];
+        glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+        glEnable(GL_SCISSOR_TEST);
+
+        int y = height - OVERLAY_MARGIN;
+        for (unsigned int i = 0; i < passCount; i++) {
+            const GLfloat* color = OVERLAY_COLORS[i % OVERLAY_COLOR_COUNT];
+            double times[2] = { passes[i].cpuRecentMs, passes[i].gpuRecentMs };
+            for (int bar = 0; bar < 2; bar++) {
+                y -= OVERLAY_BAR_HEIGHT;
+                int width = (int)(times[bar] * OVERLAY_PIXELS_PER_MS) + 1;
+                //the GPU bar is a darker shade of the pass color
+                GLfloat shade = bar == 0 ? 1.0f : 0.55f;
+                glScissor(OVERLAY_MARGIN, y, width, OVERLAY_BAR_HEIGHT);
+                glClearColor(color[0] * shade, color[1] * shade, color[2] * shade, 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT);
+            }
+            y -= 2;
+        }
+
+        //frame budget mark across all bars
+        int top = height - OVERLAY_MARGIN;
+        glScissor(OVERLAY_MARGIN + (int)(OVERLAY_FRAME_BUDGET_MS * OVERLAY_PIXELS_PER_MS), y, 1, top - y);
+        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        glDisable(GL_SCISSOR_TEST);
+        glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+    }
+
+    void FrameProfiler::printLegend(std::ostream& out) {
+        out << "Profiler overlay, CPU bar above the darker GPU bar, 20 px per ms:";
+        for (unsigned int i = 0; i < passCount; i++) {
+            out << (i > 0 ? ", " : " ") << passes[i].name << " " << OVERLAY_COLOR_NAMES[i % OVERLAY_COLOR_COUNT];
+        }
+        out << std::endl;
+    }
+
+    ProfileScope::ProfileScope(FrameProfiler& profiler, unsigned int pass) : profiler(profiler), pass(pass) {
+        profiler.beginPass(pass);
+    }
+
+    ProfileScope::~ProfileScope() {
+        profiler.endPass(pass);
+    }
+}
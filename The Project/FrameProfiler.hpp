@@ -0,0 +1,133 @@
+#ifndef FrameProfiler_hpp
+#define FrameProfiler_hpp
+
+#include <GL/glew.h>
+
+#include <chrono>
+#include <ostream>
+#include <string>
+
+namespace gps {
+
+    // Running statistics of one timing: count, sum, min and max, and a log2 histogram
+    // (BINS_PER_OCTAVE bins per doubling from 1 microsecond) for percentiles without
+    // keeping the samples; percentiles are accurate to one bin, about 4.5%
+    struct TimingStats
+    {
+        static const unsigned int BINS_PER_OCTAVE = 16;
+        static const unsigned int BINS = 24 * BINS_PER_OCTAVE + 2;
+
+        unsigned long long count;
+        double sumMs;
+        double minMs;
+        double maxMs;
+        unsigned int bins[BINS];
+
+        void reset();
+        void add(double ms);
+
+        double averageMs() const;
+        //upper edge of the bin holding the given fraction of the samples, clamped to the min and max
+        double percentileMs(double fraction) const;
+    };
+
+    // Per pass CPU and GPU times of the frames drawn on the context thread. A pass is bracketed
+    // by beginPass/endPass (or a ProfileScope): the CPU side on a steady clock, the GPU side by
+    // two GL_TIMESTAMP queries, which unlike GL_TIME_ELAPSED may nest inside an outer pass.
+    // Queries live in a ring of FRAME_RING frames and are read back once available, a few
+    // frames later, so the profiler never waits for the GPU; a frame whose queries are still
+    // pending when its slot comes around again loses its GPU times and is counted as dropped.
+    // Nothing is allocated after init, the profiler stays on in the frame loop.
+    class FrameProfiler
+    {
+    public:
+        static const unsigned int FRAME_RING = 4;
+        static const unsigned int MAX_PASSES = 16;
+
+        FrameProfiler();
+
+        //registers a pass before init, returns its id for beginPass/endPass
+        unsigned int addPass(const char* name);
+        const char* getPassName(unsigned int pass);
+
+        //creates the queries, on the context thread
+        void init();
+        void destroy();
+
+        //reads back the frames whose queries completed
+        void beginFrame();
+        void endFrame();
+
+        void beginPass(unsigned int pass);
+        void endPass(unsigned int pass);
+
+        //stats since the last call, then starts a new window
+        void printStats(std::ostream& out);
+        //forgets the stats so far, e.g. of the warm up frames; frames in flight still count
+        void reset();
+
+        //stats since start
+        void printSummary(std::ostream& out);
+        //p50 / p95 / p99 / max per pass since start
+        void printPercentiles(std::ostream& out);
+        //one row per pass with the stats since start; false when the file cannot be written
+        bool exportCsv(const std::string& path);
+
+        //a bar per pass in the top left corner of the framebuffer: CPU average on top, GPU below,
+        //20 pixels per millisecond with a mark at 16.6 ms; drawn with scissored clears
+        void drawOverlay(GLuint framebuffer, int height);
+        //pass names in their overlay colors
+        void printLegend(std::ostream& out);
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        struct Pass {
+            const char* name;
+            TimingStats cpu;
+            TimingStats gpu;
+            TimingStats cpuWindow;
+            TimingStats gpuWindow;
+            //smoothed per frame times for the overlay
+            double cpuRecentMs;
+            double gpuRecentMs;
+            Clock::time_point cpuStart;
+        };
+
+        // Queries of one frame in the ring, a begin and end timestamp per pass
+        struct FrameQueries {
+            GLuint queries[MAX_PASSES * 2];
+            bool issued[MAX_PASSES];
+            GLuint lastQuery;
+        };
+
+        Pass passes[MAX_PASSES];
+        unsigned int passCount;
+        FrameQueries frames[FRAME_RING];
+        unsigned int oldestFrame;
+        unsigned int framesInFlight;
+        FrameQueries* currentFrame;
+        bool initialized;
+
+        unsigned long long framesProfiled;
+        unsigned long long framesDropped;
+
+        //the oldest frame in flight, when its queries completed or when drop is set
+        bool collect(bool drop);
+        void printPasses(std::ostream& out, bool window);
+    };
+
+    // Brackets a pass for the lifetime of the scope
+    class ProfileScope
+    {
+    public:
+        ProfileScope(FrameProfiler& profiler, unsigned int pass);
+        ~ProfileScope();
+
+    private:
+        FrameProfiler& profiler;
+        unsigned int pass;
+    };
+}
+
+#endif /* FrameProfiler_hpp */
@@ -0,0 +1,91 @@
+#include "Frustum.hpp"
+
+#include <cmath>
+
+namespace gps {
+
+    void BoundingBox::reset() {
+        minimum = glm::vec3(INFINITY);
+        maximum = glm::vec3(-INFINITY);
+    }
+
+    bool BoundingBox::isEmpty() const {
+        return minimum.x > maximum.x || minimum.y > maximum.y || minimum.z > maximum.z;
+    }
+
+    void BoundingBox::extend(const glm::vec3& point) {
+        minimum = glm::min(minimum, point);
+        maximum = glm::max(maximum, point);
+    }
+
+    void BoundingBox::extend(const BoundingBox& box) {
+        minimum = glm::min(minimum, box.minimum);
+        maximum = glm::max(maximum, box.maximum);
+    }
+
+    BoundingBox BoundingBox::transformed(const glm::mat4& transform) const {
+        if (isEmpty()) {
+            return *this;
+        }
+
+        glm::vec3 center = (minimum + maximum) * 0.5f;
+        glm::vec3 extent = (maximum - minimum) * 0.5f;
+
+        glm::vec3 newCenter = glm::vec3(transform * glm::vec4(center, 1.0f));
+        glm::vec3 newExtent(0.0f);
+        for (int column = 0; column < 3; column++) {
+            newExtent += glm::abs(glm::vec3(transform[column])) * extent[column];
+        }
+
+        BoundingBox box;
+        box.minimum = newCenter - newExtent;
+        box.maximum = newCenter + newExtent;
+        return box;
+    }
+
+    void Frustum::extract(const glm::mat4& m) {
+        //rows of the matrix (glm is column major)
+        glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+        planes[0] = row3 + row0;
+        planes[1] = row3 - row0;
+        planes[2] = row3 + row1;
+        planes[3] = row3 - row1;
+        planes[4] = row3 + row2;
+        planes[5] = row3 - row2;
+
+        //normalize so that plane distances are in the units of the input space
+        for (int i = 0; i < 6; i++) {
+            float length = glm::length(glm::vec3(planes[i]));
+            if (length > 0.0f) {
+                planes[i] = planes[i] / length;
+            }
+        }
+    }
+
+    bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const {
+        for (int i = 0; i < 6; i++) {
+            if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Frustum::intersectsBox(const BoundingBox& box) const {
+        for (int i = 0; i < 6; i++) {
+            //corner furthest along the plane normal
+            glm::vec3 positive(
+                planes[i].x >= 0.0f ? box.maximum.x : box.minimum.x,
+                planes[i].y >= 0.0f ? box.maximum.y : box.minimum.y,
+                planes[i].z >= 0.0f ? box.maximum.z : box.minimum.z);
+            if (glm::dot(glm::vec3(planes[i]), positive) + planes[i].w < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef Frustum_hpp
+#define Frustum_hpp
+
+#include <glm/glm.hpp>
+
+namespace gps {
+
+    // Axis aligned bounding box, empty after reset()
+    struct BoundingBox
+    {
+        glm::vec3 minimum;
+        glm::vec3 maximum;
+
+        void reset();
+        bool isEmpty() const;
+        void extend(const glm::vec3& point);
+        void extend(const BoundingBox& box);
+        //box enclosing this box after the given affine transform
+        BoundingBox transformed(const glm::mat4& transform) const;
+    };
+
+    // Six clip planes (left, right, bottom, top, near, far) stored as (normal, distance),
+    // normals pointing inside. Extracted from a combined transform matrix
+    // (Gribb/Hartmann), so passing projection * view * model gives planes in model space.
+    struct Frustum
+    {
+        glm::vec4 planes[6];
+
+        void extract(const glm::mat4& transform);
+
+        //false only when the sphere is completely outside one of the planes
+        bool intersectsSphere(const glm::vec3& center, float radius) const;
+
+        //false only when the box is completely outside one of the planes
+        bool intersectsBox(const BoundingBox& box) const;
+    };
+}
+
+#endif /* Frustum_hpp */
@@ -0,0 +1,155 @@
+#include "GLDebug.hpp"
+
+#include <cstring>
+
+namespace gps {
+
+    GLDebug glDebug;
+
+    static const char* sourceName(GLenum source) {
+        switch (source) {
+        case GL_DEBUG_SOURCE_API: return "API";
+        case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "window system";
+        case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader compiler";
+        case GL_DEBUG_SOURCE_THIRD_PARTY: return "third party";
+        case GL_DEBUG_SOURCE_APPLICATION: return "application";
+        default: return "other";
+        }
+    }
+
+    static const char* typeName(GLenum type) {
+        switch (type) {
+        case GL_DEBUG_TYPE_ERROR: return "error";
+        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "undefined behavior";
+        case GL_DEBUG_TYPE_PORTABILITY: return "portability";
+        case GL_DEBUG_TYPE_PERFORMANCE: return "performance";
+        default: return "other";
+        }
+    }
+
+    static const char* severityName(GLenum severity) {
+        switch (severity) {
+        case GL_DEBUG_SEVERITY_HIGH: return "high";
+        case GL_DEBUG_SEVERITY_MEDIUM: return "medium";
+        case GL_DEBUG_SEVERITY_LOW: return "low";
+        default: return "notification";
+        }
+    }
+
+    static void copyText(char* target, const GLchar* message, GLsizei length) {
+        size_t size = length >= 0 ? (size_t)length : strlen(message);
+        if (size >= GLDebug::MESSAGE_LENGTH) {
+            size = GLDebug::MESSAGE_LENGTH - 1;
+        }
+        memcpy(target, message, size);
+        //drivers end some messages with a line break
+        while (size > 0 && (target[size - 1] == '\n' || target[size - 1] == '\r')) {
+            size--;
+        }
+        target[size] = '\0';
+    }
+
+    GLDebug::GLDebug() : kindCount(0), ringHead(0), ringCount(0), windowMessages(0), suppressed(0), installed(false) {
+        windowStart = Clock::now();
+    }
+
+    bool GLDebug::install() {
+        if (!GLEW_KHR_debug && !GLEW_VERSION_4_3) {
+            return false;
+        }
+        glEnable(GL_DEBUG_OUTPUT);
+        //not GL_DEBUG_OUTPUT_SYNCHRONOUS, which would serialize the driver like glGetError
+        glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+        glDebugMessageCallback(callback, this);
+        glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, NULL, GL_TRUE);
+        glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, NULL, GL_FALSE);
+        installed = true;
+        return true;
+    }
+
+    bool GLDebug::isInstalled() {
+        return installed;
+    }
+
+    void GLAPIENTRY GLDebug::callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+        const GLchar* message, const void* userParam) {
+        static_cast<GLDebug*>(const_cast<void*>(userParam))->receive(source, type, id, severity, length, message);
+    }
+
+    void GLDebug::receive(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message) {
+        std::lock_guard<std::mutex> guard(lock);
+
+        unsigned int kind = 0;
+        while (kind < kindCount && !(kinds[kind].source == source && kinds[kind].type == type
+            && kinds[kind].id == id && kinds[kind].severity == severity)) {
+            kind++;
+        }
+        if (kind == kindCount) {
+            if (kindCount == MAX_MESSAGE_KINDS) {
+                suppressed++;
+                return;
+            }
+            MessageKind& added = kinds[kindCount++];
+            added.source = source;
+            added.type = type;
+            added.id = id;
+            added.severity = severity;
+            added.count = 0;
+            copyText(added.text, message, length);
+        }
+        unsigned long long repeat = ++kinds[kind].count;
+        if (repeat > REPORTED_REPEATS) {
+            return;
+        }
+
+        Clock::time_point now = Clock::now();
+        if (now - windowStart >= std::chrono::seconds(1)) {
+            windowStart = now;
+            windowMessages = 0;
+        }
+        if (windowMessages == MESSAGES_PER_SECOND || ringCount == RING_SIZE) {
+            suppressed++;
+            return;
+        }
+        windowMessages++;
+
+        Message& entry = ring[(ringHead + ringCount) % RING_SIZE];
+        entry.kind = kind;
+        entry.repeat = repeat;
+        copyText(entry.text, message, length);
+        ringCount++;
+    }
+
+    void GLDebug::poll(std::ostream& out) {
+        if (ringCount.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        while (ringCount > 0) {
+            const Message& message = ring[ringHead];
+            const MessageKind& kind = kinds[message.kind];
+            out << "GL " << typeName(kind.type) << " (" << severityName(kind.severity) << ", " << sourceName(kind.source)
+                << ", id " << kind.id << "): " << message.text;
+            if (message.repeat == REPORTED_REPEATS) {
+                out << " [repeated, further ones are only counted]";
+            }
+            out << std::endl;
+            ringHead = (ringHead + 1) % RING_SIZE;
+            ringCount--;
+        }
+    }
+
+    void GLDebug::printSummary(std::ostream& out) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (kindCount == 0 && suppressed == 0) {
+            return;
+        }
+        out << "GL debug output: " << kindCount << " kinds of messages, " << suppressed << " not kept" << std::endl;
+        for (unsigned int i = 0; i < kindCount; i++) {
+            const MessageKind& kind = kinds[i];
+            out << "  " << kind.count << "x " << typeName(kind.type) << " (" << severityName(kind.severity) << ", "
+                << sourceName(kind.source) << ", id " << kind.id << "): " << kind.text << std::endl;
+        }
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef GLDebug_hpp
+#define GLDebug_hpp
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+
+namespace gps {
+
+    // Errors and performance warnings reported by the driver through KHR_debug (core in 4.3,
+    // an extension on most 4.1 drivers, missing on macOS). Messages arrive asynchronously,
+    // possibly on a driver thread, and go to a ring of RING_SIZE; poll() prints them from the
+    // frame loop, which costs one atomic load when there are none. The same message (source,
+    // type, id and severity) is printed REPORTED_REPEATS times, after that only counted; beyond
+    // MESSAGES_PER_SECOND in a second messages are counted but not kept. Unlike glGetError
+    // nothing waits for the driver. Notifications are left out, they are mostly chatter about
+    // where buffers live. Debug output is state of a context, so every context sharing with
+    // the window's installs it too; all of them report into the same instance.
+    class GLDebug
+    {
+    public:
+        static const unsigned int RING_SIZE = 64;
+        static const unsigned int MAX_MESSAGE_KINDS = 128;
+        static const unsigned int MESSAGE_LENGTH = 256;
+        static const unsigned int REPORTED_REPEATS = 3;
+        static const unsigned int MESSAGES_PER_SECOND = 20;
+
+        GLDebug();
+
+        //on the thread of each context, after glewInit and once it is current; false when the
+        //driver has no debug output
+        bool install();
+        bool isInstalled();
+
+        //prints the messages received since the last call, on the context thread
+        void poll(std::ostream& out);
+        //every kind of message received with its count, nothing when there were none
+        void printSummary(std::ostream& out);
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        struct MessageKind {
+            GLenum source;
+            GLenum type;
+            GLuint id;
+            GLenum severity;
+            unsigned long long count;
+            char text[MESSAGE_LENGTH];
+        };
+
+        struct Message {
+            unsigned int kind;
+            //the how many-th of its kind
+            unsigned long long repeat;
+            char text[MESSAGE_LENGTH];
+        };
+
+        std::mutex lock;
+        MessageKind kinds[MAX_MESSAGE_KINDS];
+        unsigned int kindCount;
+        Message ring[RING_SIZE];
+        unsigned int ringHead;
+        std::atomic<unsigned int> ringCount;
+
+        Clock::time_point windowStart;
+        unsigned int windowMessages;
+        //messages only counted: rate limited, the ring was full or there were too many kinds
+        unsigned long long suppressed;
+        std::atomic<bool> installed;
+
+        static void GLAPIENTRY callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+            const GLchar* message, const void* userParam);
+        void receive(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message);
+    };
+
+    extern GLDebug glDebug;
+}
+
+#endif /* GLDebug_hpp */
@@ -0,0 +1,102 @@
+#include "GLStats.hpp"
+
+#include <cstring>
+
+namespace gps {
+
+    GLStats glStats;
+
+    void DrawCounts::reset() {
+        memset(this, 0, sizeof(DrawCounts));
+    }
+
+    void DrawCounts::add(const DrawCounts& other) {
+        drawCalls += other.drawCalls;
+        triangles += other.triangles;
+        programSwitches += other.programSwitches;
+        redundantPrograms += other.redundantPrograms;
+        textureBinds += other.textureBinds;
+        uniformUploads += other.uniformUploads;
+        vertexArrayBinds += other.vertexArrayBinds;
+        stateChanges += other.stateChanges;
+    }
+
+    static void printCounts(std::ostream& out, const char* name, const DrawCounts& counts) {
+        out << "  " << name << ": " << counts.drawCalls << " draws, " << counts.triangles << " triangles, "
+            << counts.programSwitches << " program switches (" << counts.redundantPrograms << " redundant), "
+            << counts.textureBinds << " texture binds, " << counts.uniformUploads << " uniforms, "
+            << counts.vertexArrayBinds << " vertex array binds, " << counts.stateChanges << " other state changes" << std::endl;
+    }
+
+    GLStats::GLStats() : enabled(false), passCount(0), depth(0), boundProgram(0), haveFrame(false) {
+        for (unsigned int i = 0; i <= MAX_PASSES; i++) {
+            current[i].reset();
+            lastFrame[i].reset();
+        }
+    }
+
+    unsigned int GLStats::addPass(const char* name) {
+        if (passCount == MAX_PASSES) {
+            return MAX_PASSES - 1;
+        }
+        names[passCount] = name;
+        return passCount++;
+    }
+
+    void GLStats::setEnabled(bool enabled) {
+        this->enabled = enabled;
+    }
+
+    bool GLStats::isEnabled() {
+        return enabled;
+    }
+
+    void GLStats::beginFrame() {
+        if (!enabled) {
+            haveFrame = false;
+            return;
+        }
+        //the first frame after enabling started uncounted
+        if (haveFrame) {
+            memcpy(lastFrame, current, sizeof(current));
+        }
+        for (unsigned int i = 0; i <= passCount; i++) {
+            current[i].reset();
+        }
+        haveFrame = true;
+    }
+
+    void GLStats::beginPass(unsigned int pass) {
+        if (depth < MAX_DEPTH) {
+            passStack[depth++] = pass;
+        }
+    }
+
+    void GLStats::endPass() {
+        if (depth > 0) {
+            depth--;
+        }
+    }
+
+    void GLStats::printStats(std::ostream& out) {
+#ifdef GPS_GL_STATS
+        if (!enabled) {
+            return;
+        }
+        DrawCounts frame;
+        frame.reset();
+        for (unsigned int i = 0; i <= passCount; i++) {
+            frame.add(lastFrame[i]);
+        }
+
+        out << "GL calls of the last frame:" << std::endl;
+        printCounts(out, "Total", frame);
+        for (unsigned int i = 0; i < passCount; i++) {
+            printCounts(out, names[i], lastFrame[i + 1]);
+        }
+        printCounts(out, "Outside passes", lastFrame[0]);
+#else
+        (void)out;
+#endif
+    }
+}
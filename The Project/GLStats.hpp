@@ -0,0 +1,187 @@
+#ifndef GLStats_hpp
+#define GLStats_hpp
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <ostream>
+
+// Counting is compiled into debug builds only; release builds keep the gps::gl wrappers,
+// which are then plain inline calls of the GL functions they wrap
+#if !defined(NDEBUG) && !defined(GPS_GL_STATS_DISABLE)
+    #define GPS_GL_STATS
+#endif
+
+namespace gps {
+
+    struct DrawCounts
+    {
+        unsigned long long drawCalls;
+        unsigned long long triangles;
+        //glUseProgram calls that changed the program, and the ones that did not
+        unsigned long long programSwitches;
+        unsigned long long redundantPrograms;
+        unsigned long long textureBinds;
+        unsigned long long uniformUploads;
+        unsigned long long vertexArrayBinds;
+        //framebuffer binds, active texture units, depth function, polygon mode
+        unsigned long long stateChanges;
+
+        void reset();
+        void add(const DrawCounts& other);
+    };
+
+    // Draw calls and state changes of a frame, counted by the gps::gl wrappers below on the
+    // context thread and attributed to the innermost pass (see beginPass). Toggled at runtime,
+    // counting costs a relaxed load per call while it is off.
+    class GLStats
+    {
+    public:
+        static const unsigned int MAX_PASSES = 16;
+        static const unsigned int MAX_DEPTH = 8;
+
+        GLStats();
+
+        unsigned int addPass(const char* name);
+
+        void setEnabled(bool enabled);
+        bool isEnabled();
+
+        //keeps the counts of the frame just ended for printStats and starts a new one
+        void beginFrame();
+
+        //passes nest up to MAX_DEPTH deep, counts go to the innermost one
+        void beginPass(unsigned int pass);
+        void endPass();
+
+        //the last complete frame, per pass and in total
+        void printStats(std::ostream& out);
+
+        // Called by the wrappers
+        inline DrawCounts* counts() {
+            return enabled.load(std::memory_order_relaxed) ? &current[depth > 0 ? passStack[depth - 1] + 1 : 0] : NULL;
+        }
+        inline void countDraw(DrawCounts* counts, GLenum mode, unsigned long long vertices);
+        inline void countProgram(DrawCounts* counts, GLuint program);
+
+    private:
+        std::atomic<bool> enabled;
+        const char* names[MAX_PASSES];
+        unsigned int passCount;
+
+        //index 0 collects what happens outside of any pass
+        DrawCounts current[MAX_PASSES + 1];
+        DrawCounts lastFrame[MAX_PASSES + 1];
+        unsigned int passStack[MAX_DEPTH];
+        unsigned int depth;
+        GLuint boundProgram;
+        bool haveFrame;
+    };
+
+    extern GLStats glStats;
+
+    inline void GLStats::countDraw(DrawCounts* counts, GLenum mode, unsigned long long vertices) {
+        counts->drawCalls++;
+        counts->triangles += mode == GL_TRIANGLES ? vertices / 3 : 0;
+    }
+
+    inline void GLStats::countProgram(DrawCounts* counts, GLuint program) {
+        if (program != boundProgram) {
+            counts->programSwitches++;
+            boundProgram = program;
+        }
+        else {
+            counts->redundantPrograms++;
+        }
+    }
+
+    // The GL entry points of the render path, counted when GPS_GL_STATS is defined.
+    // Loading and setup code calls GL directly.
+    namespace gl {
+
+#ifdef GPS_GL_STATS
+    #define GPS_GL_COUNT(statement) { DrawCounts* counts = glStats.counts(); if (counts != NULL) { statement; } }
+#else
+    #define GPS_GL_COUNT(statement)
+#endif
+
+        inline void drawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+            GPS_GL_COUNT(glStats.countDraw(counts, mode, count));
+            glDrawElements(mode, count, type, indices);
+        }
+
+        inline void multiDrawElements(GLenum mode, const GLsizei* vertexCounts, GLenum type, const void* const* indices, GLsizei drawCount) {
+            GPS_GL_COUNT(
+                unsigned long long vertices = 0;
+                for (GLsizei i = 0; i < drawCount; i++) {
+                    vertices += vertexCounts[i];
+                }
+                glStats.countDraw(counts, mode, vertices));
+            glMultiDrawElements(mode, vertexCounts, type, indices, drawCount);
+        }
+
+        inline void drawArrays(GLenum mode, GLint first, GLsizei count) {
+            GPS_GL_COUNT(glStats.countDraw(counts, mode, count));
+            glDrawArrays(mode, first, count);
+        }
+
+        inline void useProgram(GLuint program) {
+            GPS_GL_COUNT(glStats.countProgram(counts, program));
+            glUseProgram(program);
+        }
+
+        inline void bindTexture(GLenum target, GLuint texture) {
+            GPS_GL_COUNT(counts->textureBinds++);
+            glBindTexture(target, texture);
+        }
+
+        inline void activeTexture(GLenum texture) {
+            GPS_GL_COUNT(counts->stateChanges++);
+            glActiveTexture(texture);
+        }
+
+        inline void bindVertexArray(GLuint array) {
+            GPS_GL_COUNT(counts->vertexArrayBinds++);
+            glBindVertexArray(array);
+        }
+
+        inline void bindFramebuffer(GLenum target, GLuint framebuffer) {
+            GPS_GL_COUNT(counts->stateChanges++);
+            glBindFramebuffer(target, framebuffer);
+        }
+
+        inline void depthFunc(GLenum func) {
+            GPS_GL_COUNT(counts->stateChanges++);
+            glDepthFunc(func);
+        }
+
+        inline void polygonMode(GLenum face, GLenum mode) {
+            GPS_GL_COUNT(counts->stateChanges++);
+            glPolygonMode(face, mode);
+        }
+
+        inline void uniform1i(GLint location, GLint value) {
+            GPS_GL_COUNT(counts->uniformUploads++);
+            glUniform1i(location, value);
+        }
+
+        inline void uniform3fv(GLint location, GLsizei count, const GLfloat* value) {
+            GPS_GL_COUNT(counts->uniformUploads++);
+            glUniform3fv(location, count, value);
+        }
+
+        inline void uniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+            GPS_GL_COUNT(counts->uniformUploads++);
+            glUniformMatrix3fv(location, count, transpose, value);
+        }
+
+        inline void uniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+            GPS_GL_COUNT(counts->uniformUploads++);
+            glUniformMatrix4fv(location, count, transpose, value);
+        }
+
+#undef GPS_GL_COUNT
+    }
+}
+
+#endif /* GLStats_hpp */
@@ -0,0 +1,158 @@
+#include "GoldenImages.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+namespace gps {
+
+    GoldenImages::GoldenImages() : interval(1), tolerance(0.0), update(false), active(false),
+        checked(0), failed(0), missing(0), written(0) {
+    }
+
+    void GoldenImages::start(const std::string& directory, unsigned int interval, double tolerance, bool update) {
+        this->directory = directory;
+        this->interval = interval > 0 ? interval : 1;
+        this->tolerance = tolerance;
+        this->update = update;
+        active = true;
+    }
+
+    bool GoldenImages::isActive() {
+        return active;
+    }
+
+    bool GoldenImages::isSelected(unsigned long long frame) {
+        return active && frame % interval == 0;
+    }
+
+    std::string GoldenImages::framePath(unsigned long long frame, const char* suffix) {
+        char name[64];
+        snprintf(name, sizeof(name), "/frame_%06llu%s.ppm", frame, suffix);
+        return directory + name;
+    }
+
+    void GoldenImages::readFramebuffer(GLuint framebuffer, int width, int height) {
+        std::vector<unsigned char> rows((size_t)width * height * 3);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        glReadBuffer(framebuffer == 0 ? GL_BACK : GL_COLOR_ATTACHMENT0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, &rows[0]);
+
+        //OpenGL returns the bottom row first
+        size_t rowSize = (size_t)width * 3;
+        pixels.resize(rows.size());
+        for (int y = 0; y < height; y++) {
+            std::copy(rows.begin() + (height - 1 - y) * rowSize, rows.begin() + (height - y) * rowSize, pixels.begin() + y * rowSize);
+        }
+    }
+
+    bool GoldenImages::check(GLuint framebuffer, int width, int height, unsigned long long frame) {
+        readFramebuffer(framebuffer, width, height);
+
+        std::string path = framePath(frame, "");
+        if (update) {
+            if (!writePPM(path, width, height, pixels)) {
+                std::cerr << "Golden images: could not write " << path << std::endl;
+                failed++;
+                return false;
+            }
+            written++;
+            return true;
+        }
+
+        checked++;
+        int goldenWidth = 0;
+        int goldenHeight = 0;
+        if (!readPPM(path, goldenWidth, goldenHeight, golden)) {
+            std::cout << "Golden images: frame " << frame << " has no golden image " << path << std::endl;
+            missing++;
+            return false;
+        }
+        if (goldenWidth != width || goldenHeight != height) {
+            std::cout << "Golden images: frame " << frame << " is " << width << "x" << height << ", the golden image "
+                << goldenWidth << "x" << goldenHeight << std::endl;
+            failed++;
+            return false;
+        }
+
+        ImageDifference difference = compareImages(pixels, golden);
+        bool match = difference.meanError <= tolerance && difference.differingFraction <= MAX_DIFFERING_FRACTION;
+        if (!match) {
+            failed++;
+            writePPM(framePath(frame, ".actual"), width, height, pixels);
+        }
+        std::cout << "Golden images: frame " << frame << (match ? " matches" : " DIFFERS") << ", mean error "
+            << difference.meanError << ", max error " << difference.maxError << ", "
+            << difference.differingFraction * 100.0 << "% of the pixels differ" << std::endl;
+        return match;
+    }
+
+    bool GoldenImages::passed() {
+        return failed == 0 && missing == 0;
+    }
+
+    void GoldenImages::printSummary() {
+        if (update) {
+            std::cout << "Golden images: " << written << " written to " << directory << std::endl;
+            return;
+        }
+        std::cout << "Golden images: " << checked << " frames checked, " << failed << " differ, " << missing
+            << " without a golden image: " << (passed() ? "passed" : "FAILED") << std::endl;
+    }
+
+    bool readPPM(const std::string& path, int& width, int& height, std::vector<unsigned char>& pixels) {
+        FILE* file = fopen(path.c_str(), "rb");
+        if (file == NULL) {
+            return false;
+        }
+        int maxValue = 0;
+        //the single whitespace after the header is consumed by the last %*c
+        bool ok = fscanf(file, "P6 %d %d %d%*c", &width, &height, &maxValue) == 3 && maxValue == 255
+            && width > 0 && height > 0;
+        if (ok) {
+            pixels.resize((size_t)width * height * 3);
+            ok = fread(&pixels[0], 1, pixels.size(), file) == pixels.size();
+        }
+        fclose(file);
+        return ok;
+    }
+
+    bool writePPM(const std::string& path, int width, int height, const std::vector<unsigned char>& pixels) {
+        FILE* file = fopen(path.c_str(), "wb");
+        if (file == NULL) {
+            return false;
+        }
+        fprintf(file, "P6\n%d %d\n255\n", width, height);
+        bool ok = fwrite(&pixels[0], 1, pixels.size(), file) == pixels.size();
+        return fclose(file) == 0 && ok;
+    }
+
+    ImageDifference compareImages(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b) {
+        ImageDifference difference = { 0.0, 0, 0.0 };
+        unsigned long long errorSum = 0;
+        size_t differing = 0;
+        for (size_t i = 0; i + 2 < a.size() && i + 2 < b.size(); i += 3) {
+            int pixelError = 0;
+            for (size_t c = 0; c < 3; c++) {
+                int error = abs((int)a[i + c] - (int)b[i + c]);
+                errorSum += error;
+                if (error > pixelError) {
+                    pixelError = error;
+                }
+            }
+            if (pixelError > difference.maxError) {
+                difference.maxError = pixelError;
+            }
+            if (pixelError > GoldenImages::PIXEL_THRESHOLD) {
+                differing++;
+            }
+        }
+        if (!a.empty()) {
+            difference.meanError = (double)errorSum / a.size();
+            difference.differingFraction = (double)differing / (a.size() / 3);
+        }
+        return difference;
+    }
+}
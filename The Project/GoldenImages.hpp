@@ -0,0 +1,70 @@
+#ifndef GoldenImages_hpp
+#define GoldenImages_hpp
+
+#include <GL/glew.h>
+
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    // How far a rendered frame is from its golden image, per 8 bit channel
+    struct ImageDifference {
+        double meanError;
+        int maxError;
+        //pixels with a channel off by more than GoldenImages::PIXEL_THRESHOLD
+        double differingFraction;
+    };
+
+    // Checks selected frames of a deterministic run (a replayed recording) against golden
+    // images: binary PPM files named like the --capture ones, frame_000030.ppm for the frame
+    // packet 30, in a directory.
+    // A frame passes when its mean channel error is within the tolerance and almost no pixel
+    // differs visibly, which absorbs rasterization and filtering differences between drivers.
+    // A failing frame is written next to its golden image as frame_000030.actual.ppm.
+    class GoldenImages
+    {
+    public:
+        static const int PIXEL_THRESHOLD = 32;
+        static constexpr double MAX_DIFFERING_FRACTION = 0.002;
+
+        GoldenImages();
+
+        //frames every interval frames are checked; update writes the golden images instead
+        void start(const std::string& directory, unsigned int interval, double tolerance, bool update);
+        bool isActive();
+        bool isSelected(unsigned long long frame);
+
+        //reads the frame back from the framebuffer, waits for the GPU; returns false on a mismatch
+        bool check(GLuint framebuffer, int width, int height, unsigned long long frame);
+
+        //false when a frame did not match or had no golden image
+        bool passed();
+        void printSummary();
+
+    private:
+        std::string directory;
+        unsigned int interval;
+        double tolerance;
+        bool update;
+        bool active;
+
+        unsigned int checked;
+        unsigned int failed;
+        unsigned int missing;
+        unsigned int written;
+
+        //top down rgb24, as in the files
+        std::vector<unsigned char> pixels;
+        std::vector<unsigned char> golden;
+
+        std::string framePath(unsigned long long frame, const char* suffix);
+        void readFramebuffer(GLuint framebuffer, int width, int height);
+    };
+
+    bool readPPM(const std::string& path, int& width, int& height, std::vector<unsigned char>& pixels);
+    bool writePPM(const std::string& path, int width, int height, const std::vector<unsigned char>& pixels);
+    ImageDifference compareImages(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b);
+}
+
+#endif /* GoldenImages_hpp */
@@ -0,0 +1,67 @@
+#include "InputQueue.hpp"
+
+namespace gps {
+
+    InputQueue::InputQueue() : head(0), tail(0), dropped(0) {
+    }
+
+    bool InputQueue::push(const InputEvent& event) {
+        size_t position = tail.load(std::memory_order_relaxed);
+        if (position - head.load(std::memory_order_acquire) == CAPACITY) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        events[position % CAPACITY] = event;
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool InputQueue::pop(InputEvent& event) {
+        size_t position = head.load(std::memory_order_relaxed);
+        if (position == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        event = events[position % CAPACITY];
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    void InputQueue::drain(InputFrame& frame) {
+        frame.keys.clear();
+        frame.cursorMoved = false;
+        frame.scrolled = false;
+        frame.scrollX = 0.0;
+        frame.scrollY = 0.0;
+        frame.firstEventTime = 0.0;
+        frame.eventCount = 0;
+
+        InputEvent event;
+        while (pop(event)) {
+            if (frame.eventCount++ == 0) {
+                frame.firstEventTime = event.time;
+            }
+
+            switch (event.type) {
+                case INPUT_KEY:
+                    frame.keys.push_back(event);
+                    break;
+                case INPUT_CURSOR:
+                    frame.cursorMoved = true;
+                    frame.cursorX = event.x;
+                    frame.cursorY = event.y;
+                    break;
+                case INPUT_SCROLL:
+                    frame.scrolled = true;
+                    frame.scrollX += event.x;
+                    frame.scrollY += event.y;
+                    break;
+            }
+        }
+    }
+
+    size_t InputQueue::getDropped() {
+        return dropped.load(std::memory_order_relaxed);
+    }
+}
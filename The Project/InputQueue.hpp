@@ -0,0 +1,75 @@
+#ifndef InputQueue_hpp
+#define InputQueue_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace gps {
+
+    enum INPUT_EVENT_TYPE {INPUT_KEY, INPUT_CURSOR, INPUT_SCROLL};
+
+    // One GLFW callback, recorded for the next frame
+    struct InputEvent
+    {
+        INPUT_EVENT_TYPE type;
+        //INPUT_KEY: GLFW key and action
+        int key;
+        int action;
+        //INPUT_CURSOR: cursor position, INPUT_SCROLL: scroll offsets
+        double x;
+        double y;
+        //glfwGetTime() when the callback ran
+        double time;
+    };
+
+    // Everything that arrived since the last drain: key events in order, cursor moves
+    // collapsed into the last position and scrolling summed, so a frame applies one camera
+    // update however fast the mouse reports
+    struct InputFrame
+    {
+        std::vector<InputEvent> keys;
+        bool cursorMoved;
+        double cursorX;
+        double cursorY;
+        bool scrolled;
+        double scrollX;
+        double scrollY;
+        //time of the first event, 0 without events
+        double firstEventTime;
+        size_t eventCount;
+    };
+
+    // Lock-free single producer, single consumer ring of input events. GLFW callbacks push,
+    // the simulation drains the queue once per frame; neither side ever blocks.
+    class InputQueue
+    {
+    public:
+        //enough for several frames of a 8 kHz mouse
+        static const size_t CAPACITY = 1024;
+
+        InputQueue();
+
+        //false when the queue is full, the event is then dropped
+        bool push(const InputEvent& event);
+
+        //oldest event, false when the queue is empty
+        bool pop(InputEvent& event);
+
+        //pops every queued event into frame, replacing its previous contents
+        void drain(InputFrame& frame);
+
+        //events dropped because the queue was full
+        size_t getDropped();
+
+    private:
+        InputEvent events[CAPACITY];
+        //written by the consumer only, on their own cache lines
+        alignas(64) std::atomic<size_t> head;
+        //written by the producer only
+        alignas(64) std::atomic<size_t> tail;
+        std::atomic<size_t> dropped;
+    };
+}
+
+#endif /* InputQueue_hpp */
@@ -0,0 +1,174 @@
+#include "InputRecording.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace gps {
+
+    static const char RECORDING_MAGIC[4] = { 'G', 'P', 'I', 'R' };
+    static const uint32_t RECORDING_VERSION = 1;
+
+    static const uint8_t STEP_CURSOR_MOVED = 1;
+    static const uint8_t STEP_SCROLLED = 2;
+
+    // fields are written as they are in memory, the targets (x86, x64, ARM) are little endian
+    template <typename T>
+    static void writeValue(FILE* file, T value) {
+        fwrite(&value, sizeof(T), 1, file);
+    }
+
+    InputRecorder::InputRecorder() : file(NULL), timeOrigin(0.0), steps(0) {
+    }
+
+    InputRecorder::~InputRecorder() {
+        close();
+    }
+
+    bool InputRecorder::open(const std::string& path, double timeOrigin) {
+        file = fopen(path.c_str(), "wb");
+        if (file == NULL) {
+            return false;
+        }
+        this->timeOrigin = timeOrigin;
+        steps = 0;
+
+        fwrite(RECORDING_MAGIC, 1, sizeof(RECORDING_MAGIC), file);
+        writeValue<uint32_t>(file, RECORDING_VERSION);
+        return true;
+    }
+
+    bool InputRecorder::isOpen() {
+        return file != NULL;
+    }
+
+    void InputRecorder::record(float deltaTime, const InputFrame& frame) {
+        uint8_t flags = (frame.cursorMoved ? STEP_CURSOR_MOVED : 0) | (frame.scrolled ? STEP_SCROLLED : 0);
+
+        writeValue<float>(file, deltaTime);
+        writeValue<uint8_t>(file, flags);
+        writeValue<uint16_t>(file, (uint16_t)frame.keys.size());
+        writeValue<uint32_t>(file, (uint32_t)frame.eventCount);
+        if (frame.cursorMoved) {
+            writeValue<double>(file, frame.cursorX);
+            writeValue<double>(file, frame.cursorY);
+        }
+        if (frame.scrolled) {
+            writeValue<double>(file, frame.scrollX);
+            writeValue<double>(file, frame.scrollY);
+        }
+        for (size_t i = 0; i < frame.keys.size(); i++) {
+            writeValue<int16_t>(file, (int16_t)frame.keys[i].key);
+            writeValue<uint8_t>(file, (uint8_t)frame.keys[i].action);
+            writeValue<float>(file, (float)(frame.keys[i].time - timeOrigin));
+        }
+        steps++;
+    }
+
+    unsigned long long InputRecorder::getStepCount() {
+        return steps;
+    }
+
+    void InputRecorder::close() {
+        if (file != NULL) {
+            fclose(file);
+            file = NULL;
+        }
+    }
+
+    InputReplay::InputReplay() : timeOrigin(0.0), position(0), stepCount(0), opened(false) {
+    }
+
+    bool InputReplay::open(const std::string& path, double timeOrigin) {
+        std::ifstream file(path.c_str(), std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+        char magic[4];
+        uint32_t version;
+        this->timeOrigin = timeOrigin;
+        position = 0;
+        if (!read(magic, sizeof(magic)) || memcmp(magic, RECORDING_MAGIC, sizeof(magic)) != 0
+            || !read(&version, sizeof(version)) || version != RECORDING_VERSION || !scan()) {
+            data.clear();
+            return false;
+        }
+
+        opened = true;
+        return true;
+    }
+
+    bool InputReplay::isOpen() {
+        return opened;
+    }
+
+    size_t InputReplay::getStepCount() {
+        return stepCount;
+    }
+
+    bool InputReplay::read(void* value, size_t size) {
+        if (data.size() - position < size) {
+            return false;
+        }
+        memcpy(value, &data[position], size);
+        position += size;
+        return true;
+    }
+
+    bool InputReplay::scan() {
+        size_t start = position;
+        InputFrame frame;
+        float deltaTime;
+
+        stepCount = 0;
+        while (position < data.size()) {
+            if (!next(deltaTime, frame)) {
+                return false;
+            }
+            stepCount++;
+        }
+
+        position = start;
+        return true;
+    }
+
+    bool InputReplay::next(float& deltaTime, InputFrame& frame) {
+        uint8_t flags;
+        uint16_t keyCount;
+        uint32_t eventCount;
+        if (!read(&deltaTime, sizeof(deltaTime)) || !read(&flags, sizeof(flags))
+            || !read(&keyCount, sizeof(keyCount)) || !read(&eventCount, sizeof(eventCount))) {
+            return false;
+        }
+
+        frame.keys.clear();
+        frame.cursorMoved = (flags & STEP_CURSOR_MOVED) != 0;
+        frame.scrolled = (flags & STEP_SCROLLED) != 0;
+        frame.scrollX = 0.0;
+        frame.scrollY = 0.0;
+        frame.firstEventTime = 0.0;
+        frame.eventCount = eventCount;
+
+        if (frame.cursorMoved && (!read(&frame.cursorX, sizeof(double)) || !read(&frame.cursorY, sizeof(double)))) {
+            return false;
+        }
+        if (frame.scrolled && (!read(&frame.scrollX, sizeof(double)) || !read(&frame.scrollY, sizeof(double)))) {
+            return false;
+        }
+
+        for (uint16_t i = 0; i < keyCount; i++) {
+            int16_t key;
+            uint8_t action;
+            float time;
+            if (!read(&key, sizeof(key)) || !read(&action, sizeof(action)) || !read(&time, sizeof(time))) {
+                return false;
+            }
+            InputEvent event = { INPUT_KEY, key, action, 0.0, 0.0, timeOrigin + time };
+            frame.keys.push_back(event);
+        }
+        return true;
+    }
+}
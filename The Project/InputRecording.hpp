@@ -0,0 +1,72 @@
+#ifndef InputRecording_hpp
+#define InputRecording_hpp
+
+#include "InputQueue.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    // Input recordings are a little endian binary file: a header ("GPIR", format version)
+    // followed by one record per simulation step with the step's delta time and its input
+    // frame as the simulation consumed it (keys in order, final cursor position, summed
+    // scrolling). Key events keep their time, in seconds since the recording started.
+    //
+    // Step: f32 deltaTime, u8 flags (1 cursor moved, 2 scrolled), u16 keys, u32 events,
+    //       [f64 cursorX, f64 cursorY], [f64 scrollX, f64 scrollY], keys * (i16 key, u8 action, f32 time)
+
+    class InputRecorder
+    {
+    public:
+        InputRecorder();
+        ~InputRecorder();
+
+        //timeOrigin is subtracted from event times; false when the file cannot be written
+        bool open(const std::string& path, double timeOrigin);
+        bool isOpen();
+
+        //one simulation step, written through the file buffer
+        void record(float deltaTime, const InputFrame& frame);
+
+        unsigned long long getStepCount();
+
+        void close();
+
+    private:
+        FILE* file;
+        double timeOrigin;
+        unsigned long long steps;
+    };
+
+    class InputReplay
+    {
+    public:
+        InputReplay();
+
+        //reads the whole recording, timeOrigin is added to event times; false when it is
+        //missing or not a recording
+        bool open(const std::string& path, double timeOrigin);
+        bool isOpen();
+
+        //the next step, false once every step was replayed; event times are kept, but the
+        //frame's first event time stays 0 so that replayed input is not measured as latency
+        bool next(float& deltaTime, InputFrame& frame);
+
+        size_t getStepCount();
+
+    private:
+        std::vector<unsigned char> data;
+        double timeOrigin;
+        size_t position;
+        size_t stepCount;
+        bool opened;
+
+        bool read(void* value, size_t size);
+        //walks the steps once to validate the file and count them
+        bool scan();
+    };
+}
+
+#endif /* InputRecording_hpp */
@@ -0,0 +1,344 @@
+#include "JobSystem.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace gps {
+
+    // failed job searches before an idle worker goes to sleep
+    static const int IDLE_SPINS = 64;
+
+    // the system and deque of the current thread when it is a worker
+    static thread_local JobSystem* workerOwner = NULL;
+    static thread_local unsigned int workerQueue = 0;
+
+    // the system and deque of the current thread when it is not a worker
+    static std::atomic<unsigned int> systemsCreated(0);
+    static thread_local unsigned int outsideSystem = 0;
+    static thread_local unsigned int outsideQueue = 0;
+
+    // Job is over aligned, which new does not honor before C++17
+    struct JobRingDeleter {
+        void operator()(Job* jobs) const {
+            for (size_t i = 0; i < MAX_JOBS_PER_THREAD; i++) {
+                jobs[i].~Job();
+            }
+#ifdef _WIN32
+            _aligned_free(jobs);
+#else
+            free(jobs);
+#endif
+        }
+    };
+
+    static Job* allocateJobRing() {
+#ifdef _WIN32
+        void* memory = _aligned_malloc(MAX_JOBS_PER_THREAD * sizeof(Job), alignof(Job));
+#else
+        void* memory = NULL;
+        if (posix_memalign(&memory, alignof(Job), MAX_JOBS_PER_THREAD * sizeof(Job)) != 0) {
+            memory = NULL;
+        }
+#endif
+        if (memory == NULL) {
+            throw std::bad_alloc();
+        }
+        Job* jobs = static_cast<Job*>(memory);
+        for (size_t i = 0; i < MAX_JOBS_PER_THREAD; i++) {
+            new (&jobs[i]) Job();
+            jobs[i].unfinishedJobs = 0;
+        }
+        return jobs;
+    }
+
+    // ring the current thread creates its jobs from
+    static thread_local std::unique_ptr<Job[], JobRingDeleter> jobRing;
+    static thread_local size_t jobsCreated = 0;
+
+    // whether the job the current thread runs is a background one
+    static thread_local bool runningBackground = false;
+
+    // where the current thread starts looking for jobs to steal
+    static thread_local unsigned int stealSeed = 0;
+
+    // shared by all the jobs of one parallelFor call, lives on the caller's stack
+    struct RangeTask {
+        JobSystem* system;
+        void (*invoke)(const void* function, size_t begin, size_t end);
+        const void* function;
+        size_t grain;
+    };
+
+    struct RangeJob {
+        const RangeTask* task;
+        size_t begin;
+        size_t end;
+    };
+
+    bool JobSystem::Queue::push(Job* job) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (back - front == MAX_JOBS_PER_THREAD) {
+            return false;
+        }
+        jobs[back++ & (MAX_JOBS_PER_THREAD - 1)] = job;
+        return true;
+    }
+
+    Job* JobSystem::Queue::pop() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (back == front) {
+            return NULL;
+        }
+        return jobs[--back & (MAX_JOBS_PER_THREAD - 1)];
+    }
+
+    Job* JobSystem::Queue::steal(bool takeBackground) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = front; i != back; i++) {
+            Job* job = jobs[i & (MAX_JOBS_PER_THREAD - 1)];
+            if (takeBackground || !job->background) {
+                //the skipped background jobs move up one and stay in order
+                for (size_t j = i; j != front; j--) {
+                    jobs[j & (MAX_JOBS_PER_THREAD - 1)] = jobs[(j - 1) & (MAX_JOBS_PER_THREAD - 1)];
+                }
+                front++;
+                return job;
+            }
+        }
+        return NULL;
+    }
+
+    JobSystem::JobSystem(unsigned int workerCount) : id(++systemsCreated), outsideThreads(0), queuedJobs(0), sleepingWorkers(0), stopping(false) {
+        if (workerCount == DEFAULT_WORKER_COUNT) {
+            unsigned int hardwareThreads = std::thread::hardware_concurrency();
+            workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+        }
+
+        firstOutsideQueue = workerCount;
+        queueCount = workerCount + MAX_OUTSIDE_THREADS;
+        queues.reset(new Queue[queueCount]);
+
+        for (unsigned int i = 0; i < workerCount; i++) {
+            workers.push_back(std::thread(&JobSystem::workerLoop, this, i));
+        }
+    }
+
+    JobSystem::~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wakeWorkers.notify_all();
+
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+    }
+
+    unsigned int JobSystem::getWorkerCount() {
+        return (unsigned int)workers.size();
+    }
+
+    JobSystem& JobSystem::shared() {
+        static JobSystem system;
+        return system;
+    }
+
+    Job* JobSystem::allocate(void (*function)(Job*), Job* parent, JOB_PRIORITY priority) {
+        if (!jobRing) {
+            jobRing.reset(allocateJobRing());
+        }
+
+        //slots still in use (a parent waited on while its caller made more jobs) are skipped
+        Job* job = NULL;
+        for (size_t i = 0; i < MAX_JOBS_PER_THREAD && job == NULL; i++) {
+            Job* candidate = &jobRing[jobsCreated++ & (MAX_JOBS_PER_THREAD - 1)];
+            if (candidate->unfinishedJobs == 0) {
+                job = candidate;
+            }
+        }
+        if (job == NULL) {
+            throw std::runtime_error("More than MAX_JOBS_PER_THREAD jobs alive on one thread");
+        }
+
+        job->function = function;
+        job->parent = parent;
+        job->unfinishedJobs = 1;
+        job->background = priority == JOB_BACKGROUND || runningBackground || (parent != NULL && parent->background);
+
+        if (parent != NULL) {
+            parent->unfinishedJobs++;
+        }
+        return job;
+    }
+
+    unsigned int JobSystem::currentQueue() {
+        if (workerOwner == this) {
+            return workerQueue;
+        }
+        if (outsideSystem != id) {
+            outsideSystem = id;
+            outsideQueue = firstOutsideQueue + outsideThreads++ % MAX_OUTSIDE_THREADS;
+        }
+        return outsideQueue;
+    }
+
+    void JobSystem::run(Job* job) {
+        //counted before it can be taken, so the count never goes negative
+        queuedJobs++;
+
+        //a full deque means the caller is far ahead of the workers, do it right away
+        if (!queues[currentQueue()].push(job)) {
+            queuedJobs--;
+            execute(job);
+            return;
+        }
+
+        //pairs with the sleeping check in workerLoop: either the worker sees the job or we see the worker
+        if (sleepingWorkers > 0) {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            wakeWorkers.notify_one();
+        }
+    }
+
+    void JobSystem::wait(const Job* job) {
+        unsigned int queue = currentQueue();
+
+        while (job->unfinishedJobs > 0) {
+            Job* next = findJob(queue);
+            if (next != NULL) {
+                execute(next);
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    bool JobSystem::runPendingJob() {
+        Job* job = findJob(currentQueue());
+        if (job == NULL) {
+            return false;
+        }
+        execute(job);
+        return true;
+    }
+
+    Job* JobSystem::findJob(unsigned int queue) {
+        //newest own job first, it is the most likely to be in the cache
+        Job* job = queues[queue].pop();
+
+        //otherwise the oldest job of somebody else, usually the biggest piece of work left;
+        //outside threads only take work from workers, which may be running their own jobs,
+        //and leave background work to them
+        if (job == NULL) {
+            bool isWorker = queue < firstOutsideQueue;
+            unsigned int victims = isWorker ? queueCount : firstOutsideQueue;
+            unsigned int start = stealSeed++;
+            for (unsigned int i = 0; i < victims && job == NULL; i++) {
+                unsigned int victim = (start + i) % victims;
+                if (victim != queue) {
+                    job = queues[victim].steal(isWorker);
+                }
+            }
+        }
+
+        if (job != NULL) {
+            queuedJobs--;
+        }
+        return job;
+    }
+
+    void JobSystem::execute(Job* job) {
+        //a job waited on inside another runs nested, so restore the outer one's flag
+        bool outerBackground = runningBackground;
+        runningBackground = job->background;
+        job->function(job);
+        runningBackground = outerBackground;
+        finish(job);
+    }
+
+    void JobSystem::finish(Job* job) {
+        //once the count reaches zero the job slot may be reused, so read the parent first
+        Job* parent = job->parent;
+        if (--job->unfinishedJobs == 0 && parent != NULL) {
+            finish(parent);
+        }
+    }
+
+    void JobSystem::workerLoop(unsigned int queue) {
+        trace::setThreadName("Worker", queue + 1);
+        workerOwner = this;
+        workerQueue = queue;
+        stealSeed = queue + 1;
+
+        int idleSpins = 0;
+        while (!stopping) {
+            Job* job = findJob(queue);
+            if (job != NULL) {
+                execute(job);
+                idleSpins = 0;
+                continue;
+            }
+
+            if (++idleSpins < IDLE_SPINS) {
+                std::this_thread::yield();
+                continue;
+            }
+            idleSpins = 0;
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepingWorkers++;
+            wakeWorkers.wait(lock, [this] { return stopping || queuedJobs > 0; });
+            sleepingWorkers--;
+        }
+    }
+
+    void JobSystem::runRange(Job* job) {
+        const RangeJob& range = *reinterpret_cast<const RangeJob*>(job->data);
+        const RangeTask& task = *range.task;
+        size_t begin = range.begin;
+        size_t end = range.end;
+
+        //hand out the upper half until the rest fits in one chunk
+        while (end - begin > task.grain) {
+            size_t middle = begin + (end - begin) / 2;
+
+            Job* child = task.system->allocate(&runRange, job);
+            RangeJob upper = { &task, middle, end };
+            new (child->data) RangeJob(upper);
+            task.system->run(child);
+
+            end = middle;
+        }
+
+        task.invoke(task.function, begin, end);
+    }
+
+    void JobSystem::parallelForRange(size_t count, size_t grain, RangeFunction invoke, const void* function) {
+        if (count == 0) {
+            return;
+        }
+        grain = std::max<size_t>(grain, 1);
+
+        //not worth waking anybody up
+        if (workers.empty() || count <= grain) {
+            invoke(function, 0, count);
+            return;
+        }
+
+        RangeTask task = { this, invoke, function, grain };
+        Job* root = allocate(&runRange, NULL);
+        RangeJob whole = { &task, 0, count };
+        new (root->data) RangeJob(whole);
+
+        execute(root);
+        wait(root);
+    }
+}
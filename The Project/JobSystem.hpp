@@ -0,0 +1,147 @@
+#ifndef JobSystem_hpp
+#define JobSystem_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace gps {
+
+    // captured data stored inline in a job, keeps a job at one cache line
+    const size_t JOB_DATA_SIZE = 40;
+    // jobs are taken round robin from a ring per creating thread, skipping unfinished ones;
+    // a thread must not have more than this many jobs alive at once
+    const size_t MAX_JOBS_PER_THREAD = 4096;
+    // one worker per hardware thread, minus the thread that submits the work
+    const unsigned int DEFAULT_WORKER_COUNT = 0xffffffffu;
+    // deques for threads that are not workers (main, render, loader), shared round robin beyond that
+    const unsigned int MAX_OUTSIDE_THREADS = 4;
+
+    // background jobs (model imports) are left to the workers, see JobSystem
+    enum JOB_PRIORITY {JOB_NORMAL, JOB_BACKGROUND};
+
+    // A unit of work. A job is finished when its function returned and all of its
+    // children are finished, so waiting on a parent waits for the whole tree.
+    struct alignas(64) Job
+    {
+        void (*function)(Job* job);
+        Job* parent;
+        std::atomic<int> unfinishedJobs;
+        //set for background jobs and every job created while one runs
+        bool background;
+        alignas(8) unsigned char data[JOB_DATA_SIZE];
+    };
+    static_assert(sizeof(Job) == 64, "a job no longer fits in one cache line");
+
+    // Work-stealing job scheduler. Every worker owns a deque: it pushes and pops its own
+    // jobs at the back and idle workers steal from the front of the others. Threads that
+    // are not workers (main, render, loader) get deques of their own and help while they
+    // wait, running their own jobs and stealing only from workers. They never steal
+    // background jobs, nor the jobs those create (the texture decodes of an import), so a
+    // frame never runs a piece of a model import another thread queued; it can still wait
+    // for a worker busy with one to finish it. Creating and running jobs does not allocate.
+    // Only CPU work goes through jobs; OpenGL calls stay on the context thread.
+    class JobSystem
+    {
+    public:
+        //with no workers every job runs on the thread that waits for it
+        explicit JobSystem(unsigned int workerCount = DEFAULT_WORKER_COUNT);
+        ~JobSystem();
+
+        //new job running function(), captures must be small and trivially destructible;
+        //a parent is not finished before this job is, create children before running the parent;
+        //the children of a background job, and jobs created while one runs, are background too
+        template <typename Function>
+        Job* create(const Function& function, Job* parent = NULL, JOB_PRIORITY priority = JOB_NORMAL) {
+            static_assert(sizeof(Function) <= JOB_DATA_SIZE, "job captures do not fit in a job");
+            static_assert(alignof(Function) <= alignof(void*), "job captures are over aligned");
+            static_assert(std::is_trivially_destructible<Function>::value, "job captures must be trivially destructible");
+
+            Job* job = allocate(&invokeJob<Function>, parent, priority);
+            new (job->data) Function(function);
+            return job;
+        }
+
+        //queues the job on the calling thread's deque
+        void run(Job* job);
+
+        //runs other jobs until the job and all of its children are finished
+        void wait(const Job* job);
+
+        //runs one job the calling thread may help with, false when there was none;
+        //for threads polling for results instead of waiting on one job
+        bool runPendingJob();
+
+        //runs function(begin, end) over [0, count) in chunks of at most grain items and waits for all of them;
+        //the range is split in halves recursively, so idle workers steal the big halves first
+        template <typename Function>
+        void parallelFor(size_t count, size_t grain, const Function& function) {
+            parallelForRange(count, grain, &invokeRange<Function>, &function);
+        }
+
+        unsigned int getWorkerCount();
+
+        //scheduler shared by loading and frame preparation
+        static JobSystem& shared();
+
+    private:
+        typedef void (*RangeFunction)(const void* function, size_t begin, size_t end);
+
+        // Deque of one thread, a plain ring guarded by a mutex
+        struct Queue {
+            std::mutex mutex;
+            Job* jobs[MAX_JOBS_PER_THREAD];
+            size_t front = 0;
+            size_t back = 0;
+
+            bool push(Job* job);
+            Job* pop();
+            //the oldest job, skipping background ones unless takeBackground
+            Job* steal(bool takeBackground);
+        };
+
+        std::vector<std::thread> workers;
+        //workers first, then the deques of outside threads
+        std::unique_ptr<Queue[]> queues;
+        unsigned int queueCount;
+        //one past the last worker deque, set before the workers start
+        unsigned int firstOutsideQueue;
+        //tells the outside threads of this system apart from those of a destroyed one
+        unsigned int id;
+        std::atomic<unsigned int> outsideThreads;
+
+        std::atomic<int> queuedJobs;
+        std::atomic<int> sleepingWorkers;
+        std::atomic<bool> stopping;
+        std::mutex sleepMutex;
+        std::condition_variable wakeWorkers;
+
+        template <typename Function>
+        static void invokeJob(Job* job) {
+            (*reinterpret_cast<Function*>(job->data))();
+        }
+
+        template <typename Function>
+        static void invokeRange(const void* function, size_t begin, size_t end) {
+            (*static_cast<const Function*>(function))(begin, end);
+        }
+
+        static void runRange(Job* job);
+
+        Job* allocate(void (*function)(Job*), Job* parent, JOB_PRIORITY priority = JOB_NORMAL);
+        void parallelForRange(size_t count, size_t grain, RangeFunction invoke, const void* function);
+        unsigned int currentQueue();
+        Job* findJob(unsigned int queue);
+        void execute(Job* job);
+        void finish(Job* job);
+        void workerLoop(unsigned int queue);
+    };
+}
+
+#endif /* JobSystem_hpp */
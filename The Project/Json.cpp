@@ -0,0 +1,39 @@
+#include "Json.hpp"
+
+#include <ctime>
+#include <thread>
+
+namespace gps {
+    namespace json {
+
+        void writeString(FILE* file, const std::string& text) {
+            fputc('"', file);
+            for (size_t i = 0; i < text.size(); i++) {
+                if (text[i] == '"' || text[i] == '\\') {
+                    fputc('\\', file);
+                    fputc(text[i], file);
+                }
+                else if ((unsigned char)text[i] < 0x20) {
+                    fprintf(file, "\\u%04x", (unsigned int)(unsigned char)text[i]);
+                }
+                else {
+                    fputc(text[i], file);
+                }
+            }
+            fputc('"', file);
+        }
+
+        void beginReport(FILE* file) {
+            char date[64];
+            time_t now = time(NULL);
+            strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+#ifdef NDEBUG
+            const char* buildType = "release";
+#else
+            const char* buildType = "debug";
+#endif
+            fprintf(file, "{\n  \"context\": {\n    \"date\": \"%s\",\n    \"num_cpus\": %u,\n    \"library_build_type\": \"%s\"\n  }",
+                date, std::thread::hardware_concurrency(), buildType);
+        }
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef Json_hpp
+#define Json_hpp
+
+#include <cstdio>
+#include <string>
+
+namespace gps {
+
+    // Pieces shared by the JSON reports (benchmark suite, startup report, trace)
+    namespace json {
+
+        //the text in quotes, with quotes, backslashes and control characters escaped
+        void writeString(FILE* file, const std::string& text);
+
+        //opens the top level object with the "context" of the run: date, hardware threads
+        //and build type, named as in Google Benchmark; the caller continues with ",\n" members
+        void beginReport(FILE* file);
+    }
+}
+
+#endif /* Json_hpp */
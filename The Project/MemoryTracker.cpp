@@ -0,0 +1,181 @@
+#include "MemoryTracker.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace gps {
+
+    static const char* KIND_NAMES[MEMORY_KIND_COUNT] = { "buffers", "textures", "renderbuffers", "geometry", "images" };
+
+    static double megabytes(size_t bytes) {
+        return bytes / (1024.0 * 1024.0);
+    }
+
+    static const char* formatName(GLenum internalFormat) {
+        switch (internalFormat) {
+        case GL_RGB: return "RGB";
+        case GL_RGBA: return "RGBA";
+        case GL_RGB8: return "RGB8";
+        case GL_RGBA8: return "RGBA8";
+        case GL_SRGB: return "SRGB";
+        case GL_SRGB8: return "SRGB8";
+        case GL_SRGB8_ALPHA8: return "SRGB8_ALPHA8";
+        case GL_DEPTH_COMPONENT: return "DEPTH";
+        case GL_DEPTH_COMPONENT16: return "DEPTH16";
+        case GL_DEPTH_COMPONENT24: return "DEPTH24";
+        case GL_DEPTH_COMPONENT32F: return "DEPTH32F";
+        case GL_DEPTH24_STENCIL8: return "DEPTH24_STENCIL8";
+        default: return "other format";
+        }
+    }
+
+    MemoryTracker::MemoryTracker() {
+        memset(bytes, 0, sizeof(bytes));
+        memset(peakBytes, 0, sizeof(peakBytes));
+    }
+
+    MemoryTracker& MemoryTracker::shared() {
+        //never destroyed, so that releases from static destructors find it
+        static MemoryTracker* tracker = new MemoryTracker();
+        return *tracker;
+    }
+
+    size_t MemoryTracker::bytesPerPixel(GLenum internalFormat) {
+        switch (internalFormat) {
+        case GL_DEPTH_COMPONENT16:
+            return 2;
+        //three channel formats are padded to four by most drivers, unsized depth is stored as 24 or 32 bits
+        default:
+            return 4;
+        }
+    }
+
+    size_t MemoryTracker::textureBytes(GLenum internalFormat, int width, int height, int layers, int levels) {
+        size_t total = 0;
+        for (int level = 0; levels == 0 || level < levels; level++) {
+            total += (size_t)width * height;
+            if (width == 1 && height == 1) {
+                break;
+            }
+            width = std::max(width / 2, 1);
+            height = std::max(height / 2, 1);
+        }
+        return total * layers * bytesPerPixel(internalFormat);
+    }
+
+    void MemoryTracker::track(MEMORY_KIND kind, unsigned long long id, size_t size, const std::string& owner, const std::string& description) {
+        std::lock_guard<std::mutex> guard(lock);
+        Resource& resource = resources[Key(kind, id)];
+        //a buffer given new storage replaces its old size
+        bytes[kind] -= resource.bytes;
+        resource.kind = kind;
+        resource.bytes = size;
+        resource.owner = owner;
+        resource.description = description;
+        bytes[kind] += size;
+        peakBytes[kind] = std::max(peakBytes[kind], bytes[kind]);
+    }
+
+    void MemoryTracker::untrack(MEMORY_KIND kind, unsigned long long id) {
+        std::lock_guard<std::mutex> guard(lock);
+        std::map<Key, Resource>::iterator resource = resources.find(Key(kind, id));
+        if (resource == resources.end()) {
+            return;
+        }
+        bytes[kind] -= resource->second.bytes;
+        resources.erase(resource);
+    }
+
+    void MemoryTracker::trackBuffer(GLuint buffer, size_t bytes, const std::string& owner, const std::string& description) {
+        track(MEMORY_BUFFER, buffer, bytes, owner, description);
+    }
+
+    void MemoryTracker::trackTexture(GLuint texture, GLenum internalFormat, int width, int height, int layers, int levels,
+        const std::string& owner, const std::string& description) {
+        char format[128];
+        snprintf(format, sizeof(format), " %dx%d%s %s%s", width, height, layers == 6 ? " cube" : "",
+            formatName(internalFormat), levels == 1 ? "" : ", mipmapped");
+        track(MEMORY_TEXTURE, texture, textureBytes(internalFormat, width, height, layers, levels), owner, description + format);
+    }
+
+    void MemoryTracker::trackRenderbuffer(GLuint renderbuffer, GLenum internalFormat, int width, int height,
+        const std::string& owner, const std::string& description) {
+        char format[128];
+        snprintf(format, sizeof(format), " %dx%d %s", width, height, formatName(internalFormat));
+        track(MEMORY_RENDERBUFFER, renderbuffer, textureBytes(internalFormat, width, height, 1, 1), owner, description + format);
+    }
+
+    void MemoryTracker::trackCpu(MEMORY_KIND kind, const void* memory, size_t bytes, const std::string& owner, const std::string& description) {
+        track(kind, (unsigned long long)(uintptr_t)memory, bytes, owner, description);
+    }
+
+    void MemoryTracker::release(MEMORY_KIND kind, GLuint name) {
+        untrack(kind, name);
+    }
+
+    void MemoryTracker::releaseCpu(MEMORY_KIND kind, const void* memory) {
+        untrack(kind, (unsigned long long)(uintptr_t)memory);
+    }
+
+    size_t MemoryTracker::getBytes(MEMORY_KIND kind) {
+        std::lock_guard<std::mutex> guard(lock);
+        return bytes[kind];
+    }
+
+    void MemoryTracker::printReport(std::ostream& out, bool detailed) {
+        std::lock_guard<std::mutex> guard(lock);
+
+        size_t gpuBytes = bytes[MEMORY_BUFFER] + bytes[MEMORY_TEXTURE] + bytes[MEMORY_RENDERBUFFER];
+        size_t cpuBytes = bytes[MEMORY_CPU_GEOMETRY] + bytes[MEMORY_CPU_IMAGE];
+        out << "Memory: GPU " << megabytes(gpuBytes) << " MB (";
+        for (int kind = MEMORY_BUFFER; kind <= MEMORY_RENDERBUFFER; kind++) {
+            out << (kind > MEMORY_BUFFER ? ", " : "") << KIND_NAMES[kind] << " " << megabytes(bytes[kind]);
+        }
+        out << "), CPU " << megabytes(cpuBytes) << " MB (geometry " << megabytes(bytes[MEMORY_CPU_GEOMETRY]) << ", images "
+            << megabytes(bytes[MEMORY_CPU_IMAGE]) << ", images at peak " << megabytes(peakBytes[MEMORY_CPU_IMAGE]) << "), "
+            << resources.size() << " resources" << std::endl;
+        if (!detailed) {
+            return;
+        }
+
+        struct Owner {
+            std::string name;
+            size_t gpuBytes;
+            size_t cpuBytes;
+            std::vector<const Resource*> resources;
+        };
+        std::map<std::string, Owner> owners;
+        for (std::map<Key, Resource>::const_iterator i = resources.begin(); i != resources.end(); ++i) {
+            const Resource& resource = i->second;
+            Owner& owner = owners[resource.owner];
+            owner.name = resource.owner;
+            (resource.kind <= MEMORY_RENDERBUFFER ? owner.gpuBytes : owner.cpuBytes) += resource.bytes;
+            owner.resources.push_back(&resource);
+        }
+
+        std::vector<Owner*> sorted;
+        for (std::map<std::string, Owner>::iterator i = owners.begin(); i != owners.end(); ++i) {
+            sorted.push_back(&i->second);
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const Owner* a, const Owner* b) {
+            return a->gpuBytes + a->cpuBytes > b->gpuBytes + b->cpuBytes;
+        });
+
+        for (size_t i = 0; i < sorted.size(); i++) {
+            Owner& owner = *sorted[i];
+            out << "  " << (owner.name.empty() ? "(no owner)" : owner.name) << ": GPU " << megabytes(owner.gpuBytes)
+                << " MB, CPU " << megabytes(owner.cpuBytes) << " MB" << std::endl;
+            std::sort(owner.resources.begin(), owner.resources.end(), [](const Resource* a, const Resource* b) {
+                return a->bytes > b->bytes;
+            });
+            for (size_t j = 0; j < owner.resources.size(); j++) {
+                const Resource& resource = *owner.resources[j];
+                out << "    " << KIND_NAMES[resource.kind] << ": " << resource.description << ", "
+                    << resource.bytes / 1024.0 << " KB" << std::endl;
+            }
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef MemoryTracker_hpp
+#define MemoryTracker_hpp
+
+#include <GL/glew.h>
+
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+namespace gps {
+
+    enum MEMORY_KIND {MEMORY_BUFFER, MEMORY_TEXTURE, MEMORY_RENDERBUFFER, MEMORY_CPU_GEOMETRY, MEMORY_CPU_IMAGE, MEMORY_KIND_COUNT};
+
+    // Sizes of the GL buffers, textures and renderbuffers and of the CPU side geometry and
+    // decoded images, recorded where they are created and released. Every resource has an
+    // owner, the model file or subsystem it belongs to, for the per asset breakdown. GPU
+    // sizes are what the data needs at the given format, mip chain included; drivers may pad
+    // or compress. Loading runs on several threads, so every call takes a lock: resources
+    // are created at load time only, never per frame.
+    class MemoryTracker
+    {
+    public:
+        //outlives every other static object, models release their resources in their destructors
+        static MemoryTracker& shared();
+
+        void trackBuffer(GLuint buffer, size_t bytes, const std::string& owner, const std::string& description);
+        //levels == 0 for a full mip chain
+        void trackTexture(GLuint texture, GLenum internalFormat, int width, int height, int layers, int levels,
+            const std::string& owner, const std::string& description);
+        void trackRenderbuffer(GLuint renderbuffer, GLenum internalFormat, int width, int height,
+            const std::string& owner, const std::string& description);
+        //CPU memory is identified by its address
+        void trackCpu(MEMORY_KIND kind, const void* memory, size_t bytes, const std::string& owner, const std::string& description);
+
+        //releasing something that was not tracked does nothing
+        void release(MEMORY_KIND kind, GLuint name);
+        void releaseCpu(MEMORY_KIND kind, const void* memory);
+
+        size_t getBytes(MEMORY_KIND kind);
+
+        //totals per kind; detailed adds a line per owner, largest first, and per resource
+        void printReport(std::ostream& out, bool detailed);
+
+        static size_t bytesPerPixel(GLenum internalFormat);
+        static size_t textureBytes(GLenum internalFormat, int width, int height, int layers, int levels);
+
+    private:
+        struct Resource {
+            MEMORY_KIND kind;
+            size_t bytes;
+            std::string owner;
+            std::string description;
+        };
+        typedef std::pair<int, unsigned long long> Key;
+
+        std::mutex lock;
+        std::map<Key, Resource> resources;
+        size_t bytes[MEMORY_KIND_COUNT];
+        size_t peakBytes[MEMORY_KIND_COUNT];
+
+        MemoryTracker();
+        void track(MEMORY_KIND kind, unsigned long long id, size_t size, const std::string& owner, const std::string& description);
+        void untrack(MEMORY_KIND kind, unsigned long long id);
+    };
+}
+
+#endif /* MemoryTracker_hpp */
@@ -1,59 +1,126 @@
 #include "Mesh.hpp"
+#include "GLStats.hpp"
+
 namespace gps {
 
+	// below this many meshlets culling costs more than drawing the whole mesh
+	static const size_t MIN_CULLED_MESHLETS = 4;
+
 	/* Mesh Constructor */
 	Mesh::Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, std::vector<Texture> textures)
 	{
-		this->vertices = vertices;
-		this->indices = indices;
-		this->textures = textures;
+		this->vertices = std::move(vertices);
+		this->indices = std::move(indices);
+		this->textures = std::move(textures);
+		this->bounds.reset();
+		this->buffers.VAO = 0;
+		this->buffers.VBO = 0;
+		this->buffers.EBO = 0;
 
-		this->setupMesh();
+		if (!this->indices.empty()) {
+			this->meshlets.build(&this->vertices[0].Position, sizeof(Vertex), &this->indices[0], this->indices.size());
+		}
 	}
 
 	Buffers Mesh::getBuffers() {
 	    return this->buffers;
 	}
 
+	size_t Mesh::getCpuBytes() {
+		return this->vertices.capacity() * sizeof(Vertex) + this->indices.capacity() * sizeof(GLuint) + this->meshlets.getBytes();
+	}
+
 	/* Mesh drawing function - also applies associated textures */
-	void Mesh::Draw(gps::Shader shader)
+	void Mesh::Draw(gps::Shader& shader)
 	{
 		shader.useShaderProgram();
 
-		//set textures
+		bindTextures(shader);
+
+		gl::bindVertexArray(this->buffers.VAO);
+		gl::drawElements(GL_TRIANGLES, this->indices.size(), GL_UNSIGNED_INT, 0);
+		gl::bindVertexArray(0);
+
+		unbindTextures();
+    }
+
+	/* Mesh drawing function with meshlet culling - small meshes are drawn whole */
+	void Mesh::Draw(gps::Shader& shader, const MeshletCullParams& cullParams)
+	{
+		size_t totalTriangles = this->indices.size() / 3;
+		meshletCullStats.totalTriangles += totalTriangles;
+
+		if (this->meshlets.size() < MIN_CULLED_MESHLETS) {
+			Draw(shader);
+			return;
+		}
+
+		ArenaVector<GLsizei> drawCounts((ArenaAllocator<GLsizei>(frameArena)));
+		ArenaVector<const void*> drawOffsets((ArenaAllocator<const void*>(frameArena)));
+		size_t visibleTriangles = this->meshlets.cull(cullParams, drawCounts, drawOffsets);
+		meshletCullStats.culledTriangles += totalTriangles - visibleTriangles;
+
+		if (drawCounts.empty()) {
+			return;
+		}
+
+		shader.useShaderProgram();
+
+		bindTextures(shader);
+
+		gl::bindVertexArray(this->buffers.VAO);
+		gl::multiDrawElements(GL_TRIANGLES, &drawCounts[0], GL_UNSIGNED_INT, &drawOffsets[0], (GLsizei)drawCounts.size());
+		gl::bindVertexArray(0);
+
+		unbindTextures();
+	}
+
+	void Mesh::bindTextures(gps::Shader& shader)
+	{
 		for (GLuint i = 0; i < textures.size(); i++)
 		{
-			glActiveTexture(GL_TEXTURE0 + i);
-			glUniform1i(glGetUniformLocation(shader.shaderProgram, this->textures[i].type.c_str()), i);
-			glBindTexture(GL_TEXTURE_2D, this->textures[i].id);
+			gl::activeTexture(GL_TEXTURE0 + i);
+			gl::uniform1i(glGetUniformLocation(shader.shaderProgram, this->textures[i].type.c_str()), i);
+			gl::bindTexture(GL_TEXTURE_2D, this->textures[i].id);
 		}
+	}
 
-		glBindVertexArray(this->buffers.VAO);
-		glDrawElements(GL_TRIANGLES, this->indices.size(), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
-
+	void Mesh::unbindTextures()
+	{
         for(GLuint i = 0; i < this->textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i);
-            glBindTexture(GL_TEXTURE_2D, 0);
+            gl::activeTexture(GL_TEXTURE0 + i);
+            gl::bindTexture(GL_TEXTURE_2D, 0);
         }
-
-    }
+	}
 
 	// Initializes all the buffer objects/arrays
 	void Mesh::setupMesh(){
-		// Create buffers/arrays
-		glGenVertexArrays(1, &this->buffers.VAO);
+		uploadBuffers();
+		setupVertexArray();
+	}
+
+	void Mesh::uploadBuffers(){
 		glGenBuffers(1, &this->buffers.VBO);
 		glGenBuffers(1, &this->buffers.EBO);
 
-		glBindVertexArray(this->buffers.VAO);
 		// Load data into vertex buffers
 		glBindBuffer(GL_ARRAY_BUFFER, this->buffers.VBO);
 		glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(Vertex), &this->vertices[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
 
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->buffers.EBO);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(GLuint), &this->indices[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+
+	void Mesh::setupVertexArray(){
+		glGenVertexArrays(1, &this->buffers.VAO);
+		glBindVertexArray(this->buffers.VAO);
+
+		// the element buffer binding is part of the vertex array state
+		glBindBuffer(GL_ARRAY_BUFFER, this->buffers.VBO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->buffers.EBO);
 
 		// Set the vertex attribute pointers
 		// Vertex Positions
@@ -67,5 +134,6 @@ namespace gps {
 		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, TexCoords));
 
 		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 }
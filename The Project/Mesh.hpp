@@ -5,6 +5,8 @@
 #include "glm/glm.hpp"
 
 #include "Shader.hpp"
+#include "Meshlet.hpp"
+#include "Frustum.hpp"
 
 #include <string>
 #include <vector>
@@ -46,19 +48,41 @@ public:
     std::vector<Vertex> vertices;
     std::vector<GLuint> indices;
     std::vector<Texture> textures;
+    // Model space bounds, recorded at import
+    BoundingBox bounds;
 
+	// Only builds the CPU side data, call setupMesh() on the context thread before drawing
 	Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, std::vector<Texture> textures);
 
 	Buffers getBuffers();
 
-	void Draw(gps::Shader shader);
+	// Memory held by the vertices, indices and meshlets on the CPU side
+	size_t getCpuBytes();
+
+	// Initializes all the buffer objects/arrays
+	void setupMesh();
+
+	// Buffer half of setupMesh, on any context sharing objects with the drawing one
+	void uploadBuffers();
+
+	// Vertex array half of setupMesh, on the drawing context (vertex arrays are not shared)
+	void setupVertexArray();
+
+	void Draw(gps::Shader& shader);
+
+	// Draws only the meshlets that survive frustum and normal cone culling, the draw
+	// ranges live in the frame arena
+	void Draw(gps::Shader& shader, const MeshletCullParams& cullParams);
 
 private:
     /*  Render data  */
     Buffers buffers;
 
-	// Initializes all the buffer objects/arrays
-	void setupMesh();
+    // Clusters used for CPU culling, built at import
+    MeshletSet meshlets;
+
+	void bindTextures(gps::Shader& shader);
+	void unbindTextures();
 
 };
 
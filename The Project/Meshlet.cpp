@@ -0,0 +1,253 @@
+#include "Meshlet.hpp"
+#include "Frustum.hpp"
+#include "JobSystem.hpp"
+#include "Simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace gps {
+
+    MeshletCullStats meshletCullStats = { 0, 0 };
+
+    // meshlet counts from which culling is split across the job system
+    static const size_t PARALLEL_CULL_THRESHOLD = 512;
+    static const size_t PARALLEL_CULL_GRAIN = 32; // groups of 4 meshlets
+
+    // cone cutoff that can never pass the backface test
+    static const float NO_CONE = 2.0f;
+
+    void MeshletCullStats::reset() {
+        totalTriangles = 0;
+        culledTriangles = 0;
+    }
+
+    float MeshletCullStats::culledPercentage() {
+        if (totalTriangles == 0) {
+            return 0.0f;
+        }
+        return 100.0f * (float)culledTriangles / (float)totalTriangles;
+    }
+
+    size_t MeshletSet::size() {
+        return firstIndex.size();
+    }
+
+    size_t MeshletSet::getBytes() {
+        //eight float arrays of bounds and cones, two index ones and the visibility flags
+        return (firstIndex.capacity() + indexCount.capacity()) * sizeof(GLuint)
+            + (centerX.capacity() + centerY.capacity() + centerZ.capacity() + radius.capacity()
+            + axisX.capacity() + axisY.capacity() + axisZ.capacity() + cutoff.capacity()) * sizeof(float)
+            + visible.capacity();
+    }
+
+    void MeshletSet::build(const glm::vec3* positions, size_t strideInBytes, const GLuint* indices, size_t indexTotal) {
+        size_t triangleCount = indexTotal / 3;
+        size_t meshletCount = (triangleCount + TRIANGLES_PER_MESHLET - 1) / TRIANGLES_PER_MESHLET;
+        size_t paddedCount = (meshletCount + 3) & ~size_t(3);
+
+        firstIndex.resize(meshletCount);
+        indexCount.resize(meshletCount);
+        centerX.assign(paddedCount, 0.0f);
+        centerY.assign(paddedCount, 0.0f);
+        centerZ.assign(paddedCount, 0.0f);
+        radius.assign(paddedCount, 0.0f);
+        axisX.assign(paddedCount, 0.0f);
+        axisY.assign(paddedCount, 0.0f);
+        axisZ.assign(paddedCount, 0.0f);
+        cutoff.assign(paddedCount, NO_CONE);
+        visible.assign(paddedCount, 1);
+
+        const char* positionBytes = (const char*)positions;
+        std::vector<glm::vec3> faceNormals;
+        faceNormals.reserve(TRIANGLES_PER_MESHLET);
+
+        for (size_t m = 0; m < meshletCount; m++) {
+            size_t firstTriangle = m * TRIANGLES_PER_MESHLET;
+            size_t meshletTriangles = std::min<size_t>(TRIANGLES_PER_MESHLET, triangleCount - firstTriangle);
+            firstIndex[m] = (GLuint)(firstTriangle * 3);
+            indexCount[m] = (GLuint)(meshletTriangles * 3);
+
+            //bounding sphere around the center of the box
+            glm::vec3 minimum(INFINITY);
+            glm::vec3 maximum(-INFINITY);
+            for (size_t i = firstIndex[m]; i < firstIndex[m] + indexCount[m]; i++) {
+                const glm::vec3& p = *(const glm::vec3*)(positionBytes + indices[i] * strideInBytes);
+                minimum = glm::min(minimum, p);
+                maximum = glm::max(maximum, p);
+            }
+            glm::vec3 center = (minimum + maximum) * 0.5f;
+            float maxDistance = 0.0f;
+            for (size_t i = firstIndex[m]; i < firstIndex[m] + indexCount[m]; i++) {
+                const glm::vec3& p = *(const glm::vec3*)(positionBytes + indices[i] * strideInBytes);
+                maxDistance = std::max(maxDistance, glm::length(p - center));
+            }
+
+            //normal cone from the (counter clock-wise) face normals
+            faceNormals.clear();
+            glm::vec3 normalSum(0.0f);
+            for (size_t t = 0; t < meshletTriangles; t++) {
+                size_t i = firstIndex[m] + t * 3;
+                const glm::vec3& a = *(const glm::vec3*)(positionBytes + indices[i] * strideInBytes);
+                const glm::vec3& b = *(const glm::vec3*)(positionBytes + indices[i + 1] * strideInBytes);
+                const glm::vec3& c = *(const glm::vec3*)(positionBytes + indices[i + 2] * strideInBytes);
+                glm::vec3 n = glm::cross(b - a, c - a);
+                float length = glm::length(n);
+                if (length > 1e-12f) {
+                    faceNormals.push_back(n / length);
+                    normalSum += n / length;
+                }
+            }
+
+            float coneCutoff = NO_CONE;
+            glm::vec3 axis(0.0f);
+            float sumLength = glm::length(normalSum);
+            if (!faceNormals.empty() && sumLength > 1e-6f) {
+                axis = normalSum / sumLength;
+                float minDot = 1.0f;
+                for (size_t t = 0; t < faceNormals.size(); t++) {
+                    minDot = std::min(minDot, glm::dot(faceNormals[t], axis));
+                }
+                //the cone is only useful when it is narrower than a half space
+                if (minDot > 0.0f) {
+                    coneCutoff = std::sqrt(1.0f - minDot * minDot);
+                }
+            }
+
+            centerX[m] = center.x;
+            centerY[m] = center.y;
+            centerZ[m] = center.z;
+            radius[m] = maxDistance;
+            axisX[m] = axis.x;
+            axisY[m] = axis.y;
+            axisZ[m] = axis.z;
+            cutoff[m] = coneCutoff;
+        }
+    }
+
+    // A meshlet is culled when its sphere is outside a frustum plane, or when every triangle
+    // of its normal cone faces away from the viewer:
+    //   perspective:  dot(center - eye, axis) >= cutoff * |center - eye| + radius
+    //   orthographic: dot(viewDirection, axis) >= cutoff
+    // begin and end count groups of 4 meshlets.
+    void MeshletSet::cullRange(const MeshletCullParams& params, const glm::vec4* planes, size_t begin, size_t end) {
+#if defined(GPS_SIMD_SSE)
+        __m128 eyeX = _mm_set1_ps(params.viewPosition.x);
+        __m128 eyeY = _mm_set1_ps(params.viewPosition.y);
+        __m128 eyeZ = _mm_set1_ps(params.viewPosition.z);
+        __m128 dirX = _mm_set1_ps(params.viewDirection.x);
+        __m128 dirY = _mm_set1_ps(params.viewDirection.y);
+        __m128 dirZ = _mm_set1_ps(params.viewDirection.z);
+        __m128 zero = _mm_setzero_ps();
+
+        for (size_t group = begin; group < end; group++) {
+            size_t i = group * 4;
+            __m128 cx = _mm_loadu_ps(&centerX[i]);
+            __m128 cy = _mm_loadu_ps(&centerY[i]);
+            __m128 cz = _mm_loadu_ps(&centerZ[i]);
+            __m128 r = _mm_loadu_ps(&radius[i]);
+            __m128 negativeR = _mm_sub_ps(zero, r);
+
+            __m128 culled = zero;
+            for (int p = 0; p < 6; p++) {
+                __m128 distance = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p].x), cx), _mm_mul_ps(_mm_set1_ps(planes[p].y), cy)),
+                    _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p].z), cz), _mm_set1_ps(planes[p].w)));
+                culled = _mm_or_ps(culled, _mm_cmplt_ps(distance, negativeR));
+            }
+
+            __m128 ax = _mm_loadu_ps(&axisX[i]);
+            __m128 ay = _mm_loadu_ps(&axisY[i]);
+            __m128 az = _mm_loadu_ps(&axisZ[i]);
+            __m128 c = _mm_loadu_ps(&cutoff[i]);
+            if (params.orthographic) {
+                __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dirX, ax), _mm_mul_ps(dirY, ay)), _mm_mul_ps(dirZ, az));
+                culled = _mm_or_ps(culled, _mm_cmpge_ps(d, c));
+            }
+            else {
+                __m128 vx = _mm_sub_ps(cx, eyeX);
+                __m128 vy = _mm_sub_ps(cy, eyeY);
+                __m128 vz = _mm_sub_ps(cz, eyeZ);
+                __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, ax), _mm_mul_ps(vy, ay)), _mm_mul_ps(vz, az));
+                __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz)));
+                culled = _mm_or_ps(culled, _mm_cmpge_ps(d, _mm_add_ps(_mm_mul_ps(c, length), r)));
+            }
+
+            int mask = _mm_movemask_ps(culled);
+            visible[i + 0] = (mask & 1) == 0;
+            visible[i + 1] = (mask & 2) == 0;
+            visible[i + 2] = (mask & 4) == 0;
+            visible[i + 3] = (mask & 8) == 0;
+        }
+#else
+        for (size_t i = begin * 4; i < end * 4; i++) {
+            glm::vec3 center(centerX[i], centerY[i], centerZ[i]);
+            glm::vec3 axis(axisX[i], axisY[i], axisZ[i]);
+
+            bool culled = false;
+            for (int p = 0; p < 6 && !culled; p++) {
+                culled = glm::dot(glm::vec3(planes[p]), center) + planes[p].w < -radius[i];
+            }
+
+            if (!culled) {
+                if (params.orthographic) {
+                    culled = glm::dot(params.viewDirection, axis) >= cutoff[i];
+                }
+                else {
+                    glm::vec3 v = center - params.viewPosition;
+                    culled = glm::dot(v, axis) >= cutoff[i] * glm::length(v) + radius[i];
+                }
+            }
+
+            visible[i] = !culled;
+        }
+#endif
+    }
+
+    size_t MeshletSet::cull(const MeshletCullParams& params, ArenaVector<GLsizei>& counts, ArenaVector<const void*>& offsets) {
+        counts.clear();
+        offsets.clear();
+
+        size_t meshletCount = firstIndex.size();
+        if (meshletCount == 0) {
+            return 0;
+        }
+        //growing an arena vector leaves the old storage behind, take the worst case at once
+        counts.reserve(meshletCount);
+        offsets.reserve(meshletCount);
+
+        Frustum frustum;
+        frustum.extract(params.modelViewProjection);
+
+        size_t groupCount = visible.size() / 4;
+        if (meshletCount >= PARALLEL_CULL_THRESHOLD) {
+            JobSystem::shared().parallelFor(groupCount, PARALLEL_CULL_GRAIN, [&](size_t begin, size_t end) {
+                cullRange(params, frustum.planes, begin, end);
+            });
+        }
+        else {
+            cullRange(params, frustum.planes, 0, groupCount);
+        }
+
+        //merge neighbouring visible meshlets into a single index range
+        size_t visibleTriangles = 0;
+        GLuint rangeEnd = 0;
+        for (size_t m = 0; m < meshletCount; m++) {
+            if (!visible[m]) {
+                continue;
+            }
+
+            visibleTriangles += indexCount[m] / 3;
+            if (!counts.empty() && rangeEnd == firstIndex[m]) {
+                counts.back() += indexCount[m];
+            }
+            else {
+                counts.push_back(indexCount[m]);
+                offsets.push_back((const void*)(firstIndex[m] * sizeof(GLuint)));
+            }
+            rangeEnd = firstIndex[m] + indexCount[m];
+        }
+
+        return visibleTriangles;
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef Meshlet_hpp
+#define Meshlet_hpp
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Arena.hpp"
+
+#include <vector>
+
+namespace gps {
+
+    // What a draw is seen from, expressed in the model space of the drawn object
+    struct MeshletCullParams
+    {
+        glm::mat4 modelViewProjection;
+        //eye position (perspective views)
+        glm::vec3 viewPosition;
+        //normalized view direction (orthographic views, e.g. the directional light)
+        glm::vec3 viewDirection;
+        bool orthographic;
+    };
+
+    // Triangle counters of all culled draws since the last reset
+    struct MeshletCullStats
+    {
+        unsigned long long totalTriangles;
+        unsigned long long culledTriangles;
+
+        void reset();
+        float culledPercentage();
+    };
+
+    extern MeshletCullStats meshletCullStats;
+
+    // A mesh split into fixed-size clusters of consecutive triangles, each with a
+    // bounding sphere and a normal cone. Bounds are kept as structure of arrays,
+    // padded to a multiple of 4, so that they can be tested 4 at a time.
+    class MeshletSet
+    {
+    public:
+        static const GLuint TRIANGLES_PER_MESHLET = 128;
+
+        //positions are read with the given byte stride, indices describe a triangle list
+        void build(const glm::vec3* positions, size_t strideInBytes, const GLuint* indices, size_t indexCount);
+
+        size_t size();
+
+        //memory held by the cluster data
+        size_t getBytes();
+
+        //culls against the view frustum and the normal cones and fills counts/offsets with the merged
+        //index ranges of the visible meshlets (glMultiDrawElements arguments); returns the visible triangle count.
+        //There are never more ranges than meshlets, so room for size() of them is reserved first.
+        size_t cull(const MeshletCullParams& params, ArenaVector<GLsizei>& counts, ArenaVector<const void*>& offsets);
+
+    private:
+        std::vector<GLuint> firstIndex;
+        std::vector<GLuint> indexCount;
+
+        std::vector<float> centerX, centerY, centerZ, radius;
+        std::vector<float> axisX, axisY, axisZ, cutoff;
+
+        std::vector<unsigned char> visible;
+
+        void cullRange(const MeshletCullParams& params, const glm::vec4* planes, size_t begin, size_t end);
+    };
+}
+
+#endif /* Meshlet_hpp */
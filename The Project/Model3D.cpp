@@ -1,108 +1,387 @@
 #include "Model3D.hpp"
+#include "Arena.hpp"
+#include "FileIO.hpp"
+#include "JobSystem.hpp"
+#include "MemoryTracker.hpp"
+#include "Trace.hpp"
+
+#include <sstream>
 
 namespace gps {
 
+	Model3D::Model3D() : resident(false)
+	{
+	}
+
 	void Model3D::LoadModel(std::string fileName)
 	{
-        std::string basePath = fileName.substr(0, fileName.find_last_of('/')) + "/";
-		ReadOBJ(fileName, basePath);
+		Import(fileName);
+		Upload();
 	}
 
     void Model3D::LoadModel(std::string fileName, std::string basePath)
 	{
+		Import(fileName, basePath);
+		Upload();
+	}
+
+	void Model3D::Import(std::string fileName)
+	{
+        std::string basePath = fileName.substr(0, fileName.find_last_of('/')) + "/";
+		Import(fileName, basePath);
+	}
+
+	void Model3D::Import(std::string fileName, std::string basePath)
+	{
+		TraceScope trace("Import model", "loading", fileName.c_str());
+		name = fileName;
 		ReadOBJ(fileName, basePath);
+
+		// the meshes stay where they are from now on
+		for (size_t i = 0; i < meshes.size(); i++) {
+			std::ostringstream description;
+			description << "mesh " << i << ", " << meshes[i].vertices.size() << " vertices, "
+				<< meshes[i].indices.size() << " indices and meshlets";
+			MemoryTracker::shared().trackCpu(MEMORY_CPU_GEOMETRY, &meshes[i], meshes[i].getCpuBytes(), name, description.str());
+		}
+
+		// every texture is decoded by its own job
+		textureImages.resize(loadedTextures.size());
+		JobSystem::shared().parallelFor(loadedTextures.size(), 1, [this](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				textureImages[i] = ReadTextureFromFile(loadedTextures[i].path.c_str());
+			}
+		});
+	}
+
+	void Model3D::Upload()
+	{
+		UploadResources();
+		SetupVertexArrays();
+	}
+
+	void Model3D::UploadResources()
+	{
+		TraceScope trace("Upload model", "loading", name.c_str());
+		for (size_t i = 0; i < loadedTextures.size(); i++) {
+			TraceScope textureTrace("Upload texture", "loading", loadedTextures[i].path.c_str());
+			loadedTextures[i].id = UploadTexture(textureImages[i]);
+			if (loadedTextures[i].id != 0) {
+				MemoryTracker::shared().trackTexture(loadedTextures[i].id, GL_SRGB, textureImages[i].width, textureImages[i].height,
+					1, 0, name, loadedTextures[i].path);
+			}
+		}
+		textureImages.clear();
+
+		// the meshes got copies of the textures before they had an id
+		for (size_t i = 0; i < meshes.size(); i++) {
+			for (size_t t = 0; t < meshes[i].textures.size(); t++) {
+				for (size_t j = 0; j < loadedTextures.size(); j++) {
+					if (meshes[i].textures[t].path == loadedTextures[j].path) {
+						meshes[i].textures[t].id = loadedTextures[j].id;
+					}
+				}
+			}
+			meshes[i].uploadBuffers();
+
+			std::ostringstream description;
+			description << "mesh " << i;
+			Buffers buffers = meshes[i].getBuffers();
+			MemoryTracker::shared().trackBuffer(buffers.VBO, meshes[i].vertices.size() * sizeof(Vertex), name, description.str() + " vertices");
+			MemoryTracker::shared().trackBuffer(buffers.EBO, meshes[i].indices.size() * sizeof(GLuint), name, description.str() + " indices");
+		}
+	}
+
+	void Model3D::SetupVertexArrays()
+	{
+		TraceScope trace("Setup vertex arrays", "loading", name.c_str());
+		for (size_t i = 0; i < meshes.size(); i++) {
+			meshes[i].setupVertexArray();
+		}
+		resident = true;
+	}
+
+	bool Model3D::isResident()
+	{
+		return resident;
 	}
 
 	// Draw each mesh from the model
-	void Model3D::Draw(gps::Shader shaderProgram)
+	void Model3D::Draw(gps::Shader& shaderProgram)
 	{
 		for (int i = 0; i < meshes.size(); i++)
 			meshes[i].Draw(shaderProgram);
 	}
 
-	// Does the parsing of the .obj file and fills in the data structure
-	void Model3D::ReadOBJ(std::string fileName, std::string basePath){
+	// Draw each mesh from the model, skipping meshes and meshlets that cannot be seen
+	void Model3D::Draw(gps::Shader& shaderProgram, const MeshletCullParams& cullParams)
+	{
+		Frustum frustum;
+		frustum.extract(cullParams.modelViewProjection);
 
-        std::cout << "Loading : " << fileName << std::endl;
-		tinyobj::attrib_t attrib;
-		std::vector<tinyobj::shape_t> shapes;
-		std::vector<tinyobj::material_t> materials;
+		for (size_t i = 0; i < meshes.size(); i++) {
+			if (meshes.size() > 1 && !meshes[i].bounds.isEmpty() && !frustum.intersectsBox(meshes[i].bounds))
+				continue;
+			meshes[i].Draw(shaderProgram, cullParams);
+		}
+	}
+
+	BoundingBox Model3D::getBounds()
+	{
+		return bounds;
+	}
+
+	std::vector<glm::vec3> Model3D::getTriangles()
+	{
+		std::vector<glm::vec3> triangles;
+		for (size_t i = 0; i < meshes.size(); i++) {
+			const gps::Mesh& mesh = meshes[i];
+			for (size_t j = 0; j < mesh.indices.size(); j++) {
+				triangles.push_back(mesh.vertices[mesh.indices[j]].Position);
+			}
+		}
+		return triangles;
+	}
+
+	// Temporaries of an import, released in bulk after every model. ReadOBJ never runs
+	// jobs, so one import at a time uses the arena of its thread.
+	static thread_local Arena importArena;
+
+	// One shape while the .obj file is parsed
+	struct ObjShape {
+		// triangulated, three per face
+		ArenaVector<tinyobj::index_t> indices;
+		// material of the first face
 		int materialId;
 
-		std::string err;
-		bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, fileName.c_str(), basePath.c_str(), GL_TRUE);
+		explicit ObjShape(Arena& arena) : indices(ArenaAllocator<tinyobj::index_t>(arena)), materialId(-1) {}
+	};
+
+	// State of tinyobj::LoadObjWithCallback, builds what LoadObj returns (same shape
+	// splitting and triangulation) without a heap allocation per face
+	struct ObjParser {
+		Arena& arena;
+		ArenaVector<float> positions;
+		ArenaVector<float> normals;
+		ArenaVector<float> texcoords;
+		ArenaVector<ObjShape> shapes;
+		ObjShape shape;
+		// faces since the last material change; LoadObj drops a shape with none at the next group
+		size_t pendingFaces;
+		size_t faceCount;
+		int material;
+		std::vector<tinyobj::material_t> materials;
 
-		if (!err.empty()) { // `err` may contain warning message.
-			std::cerr << err << std::endl;
+		explicit ObjParser(Arena& arena) :
+			arena(arena),
+			positions(ArenaAllocator<float>(arena)),
+			normals(ArenaAllocator<float>(arena)),
+			texcoords(ArenaAllocator<float>(arena)),
+			shapes(ArenaAllocator<ObjShape>(arena)),
+			shape(arena),
+			pendingFaces(0),
+			faceCount(0),
+			material(-1) {}
+	};
+
+	// Reads the .mtl files named by the .obj file and keeps their materials
+	class ObjMaterialReader : public tinyobj::MaterialFileReader {
+	public:
+		ObjMaterialReader(const std::string& basePath, ObjParser& parser) : tinyobj::MaterialFileReader(basePath), parser(parser) {}
+
+		virtual bool operator()(const std::string& matId, std::vector<tinyobj::material_t>* materials,
+			std::map<std::string, int>* matMap, std::string* err) {
+			bool ok = tinyobj::MaterialFileReader::operator()(matId, materials, matMap, err);
+			parser.materials = *materials;
+			return ok;
 		}
 
-		if (!ret) {
-			exit(1);
+	private:
+		ObjParser& parser;
+	};
+
+	static void objVertex(void* user, float x, float y, float z, float w) {
+		ObjParser* parser = static_cast<ObjParser*>(user);
+		parser->positions.push_back(x);
+		parser->positions.push_back(y);
+		parser->positions.push_back(z);
+	}
+
+	static void objNormal(void* user, float x, float y, float z) {
+		ObjParser* parser = static_cast<ObjParser*>(user);
+		parser->normals.push_back(x);
+		parser->normals.push_back(y);
+		parser->normals.push_back(z);
+	}
+
+	static void objTexcoord(void* user, float x, float y, float z) {
+		ObjParser* parser = static_cast<ObjParser*>(user);
+		parser->texcoords.push_back(x);
+		parser->texcoords.push_back(y);
+	}
+
+	// .obj indices start at 1 and count back from the end when negative, 0 means missing
+	static int objIndex(int index, size_t count) {
+		if (index > 0) return index - 1;
+		if (index < 0) return (int)count + index;
+		return -1;
+	}
+
+	static tinyobj::index_t objCorner(const ObjParser* parser, const tinyobj::index_t& raw) {
+		tinyobj::index_t corner;
+		corner.vertex_index = objIndex(raw.vertex_index, parser->positions.size() / 3);
+		corner.normal_index = objIndex(raw.normal_index, parser->normals.size() / 3);
+		corner.texcoord_index = objIndex(raw.texcoord_index, parser->texcoords.size() / 2);
+		return corner;
+	}
+
+	static void objFace(void* user, tinyobj::index_t* indices, int count) {
+		ObjParser* parser = static_cast<ObjParser*>(user);
+		parser->pendingFaces++;
+		parser->faceCount++;
+
+		// polygon -> triangle fan
+		for (int k = 2; k < count; k++) {
+			if (parser->shape.indices.empty()) {
+				parser->shape.materialId = parser->material;
+			}
+			parser->shape.indices.push_back(objCorner(parser, indices[0]));
+			parser->shape.indices.push_back(objCorner(parser, indices[k - 1]));
+			parser->shape.indices.push_back(objCorner(parser, indices[k]));
 		}
+	}
 
-		std::cout << "# of shapes    : " << shapes.size() << std::endl;
-		std::cout << "# of materials : " << materials.size() << std::endl;
+	static void objUseMaterial(void* user, const char* name, int materialId) {
+		ObjParser* parser = static_cast<ObjParser*>(user);
+		if (materialId != parser->material) {
+			parser->pendingFaces = 0;
+			parser->material = materialId;
+		}
+	}
 
-		// Loop over shapes
-		for (size_t s = 0; s < shapes.size(); s++) {
-			std::vector<gps::Vertex> vertices;
-			std::vector<GLuint> indices;
-			std::vector<gps::Texture> textures;
+	static void objFlushShape(ObjParser* parser) {
+		if (parser->pendingFaces > 0) {
+			parser->shapes.push_back(parser->shape);
+		}
+		parser->shape = ObjShape(parser->arena);
+		parser->pendingFaces = 0;
+	}
 
-			// Loop over faces(polygon)
-			size_t index_offset = 0;
-			for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++) {
-				int fv = shapes[s].mesh.num_face_vertices[f];
+	static void objGroup(void* user, const char** names, int count) {
+		objFlushShape(static_cast<ObjParser*>(user));
+	}
 
-				//gps::Texture currentTexture = LoadTexture("index1.png", "ambientTexture");
-				//textures.push_back(currentTexture);
+	static void objObject(void* user, const char* name) {
+		objFlushShape(static_cast<ObjParser*>(user));
+	}
 
-				// Loop over vertices in the face.
-				for (size_t v = 0; v < fv; v++) {
-					// access to vertex
-					tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
+	// Does the parsing of the .obj file and fills in the data structure
+	void Model3D::ReadOBJ(std::string fileName, std::string basePath){
+		TraceScope trace("Parse OBJ", "loading", fileName.c_str());
+
+		// one write per message, models are imported from several threads
+		std::ostringstream log;
+		log << "Loading : " << fileName << std::endl;
+
+		size_t faceCount = 0;
+		{
+			ObjParser parser(importArena);
+			ObjMaterialReader materialReader(basePath, parser);
+
+			tinyobj::callback_t callback;
+			callback.vertex_cb = objVertex;
+			callback.normal_cb = objNormal;
+			callback.texcoord_cb = objTexcoord;
+			callback.index_cb = objFace;
+			callback.usemtl_cb = objUseMaterial;
+			callback.group_cb = objGroup;
+			callback.object_cb = objObject;
+
+			// read in one go, so that the file I/O is timed apart from the parsing
+			std::string err;
+			std::vector<char> contents;
+			bool opened = readFile(fileName, contents);
+			MemoryStreamBuffer buffer(contents.data(), contents.size());
+			std::istream file(&buffer);
+			bool ret = opened && tinyobj::LoadObjWithCallback(file, callback, &parser, &materialReader, &err);
+			if (!opened) {
+				err = "Cannot open file [" + fileName + "]\n";
+			}
+
+			if (!err.empty()) { // `err` may contain warning message.
+				std::cerr << err + "\n";
+			}
+
+			// the model stays empty; an import runs on a job thread, where exit() would tear
+			// the process down under the other threads
+			if (!ret) {
+				std::cerr << "Could not import " << fileName << ", it is left out of the scene\n";
+				parser.shapes.clear();
+				parser.shape.indices.clear();
+				parser.pendingFaces = 0;
+			}
+
+			if (parser.pendingFaces > 0 || !parser.shape.indices.empty()) {
+				parser.shapes.push_back(parser.shape);
+			}
 
-					float vx = attrib.vertices[3 * idx.vertex_index + 0];
-					float vy = attrib.vertices[3 * idx.vertex_index + 1];
-					float vz = attrib.vertices[3 * idx.vertex_index + 2];
-					float nx = attrib.normals[3 * idx.normal_index + 0];
-					float ny = attrib.normals[3 * idx.normal_index + 1];
-					float nz = attrib.normals[3 * idx.normal_index + 2];
-					float tx = 0.0f;
-					float ty = 0.0f;
+			faceCount = parser.faceCount;
+			const std::vector<tinyobj::material_t>& materials = parser.materials;
+			log << "# of shapes    : " << parser.shapes.size() << std::endl;
+			log << "# of materials : " << materials.size() << std::endl;
+
+			bounds.reset();
+
+			// Loop over shapes
+			for (size_t s = 0; s < parser.shapes.size(); s++) {
+				const ObjShape& shape = parser.shapes[s];
+
+				// sized once, they are moved into the mesh
+				std::vector<gps::Vertex> vertices;
+				std::vector<GLuint> indices;
+				std::vector<gps::Texture> textures;
+				vertices.reserve(shape.indices.size());
+				indices.reserve(shape.indices.size());
+				gps::BoundingBox shapeBounds;
+				shapeBounds.reset();
+
+				// one vertex per face corner
+				for (size_t i = 0; i < shape.indices.size(); i++) {
+					tinyobj::index_t idx = shape.indices[i];
+
+					glm::vec3 vertexPosition(
+						parser.positions[3 * idx.vertex_index + 0],
+						parser.positions[3 * idx.vertex_index + 1],
+						parser.positions[3 * idx.vertex_index + 2]);
+					glm::vec3 vertexNormal(0.0f);
+					if (idx.normal_index != -1) {
+						vertexNormal = glm::vec3(
+							parser.normals[3 * idx.normal_index + 0],
+							parser.normals[3 * idx.normal_index + 1],
+							parser.normals[3 * idx.normal_index + 2]);
+					}
+					glm::vec2 vertexTexCoords(0.0f);
 					if (idx.texcoord_index != -1) {
-						tx = attrib.texcoords[2 * idx.texcoord_index + 0];
-						ty = attrib.texcoords[2 * idx.texcoord_index + 1];
+						vertexTexCoords = glm::vec2(
+							parser.texcoords[2 * idx.texcoord_index + 0],
+							parser.texcoords[2 * idx.texcoord_index + 1]);
 					}
 
-					glm::vec3 vertexPosition(vx, vy, vz);
-					glm::vec3 vertexNormal(nx, ny, nz);
-					glm::vec2 vertexTexCoords(tx, ty);
-
 					gps::Vertex currentVertex;
 					currentVertex.Position = vertexPosition;
 					currentVertex.Normal = vertexNormal;
 					currentVertex.TexCoords = vertexTexCoords;
 
 					vertices.push_back(currentVertex);
+					shapeBounds.extend(vertexPosition);
 
-					indices.push_back(index_offset + v);
+					indices.push_back((GLuint)i);
 				}
 
-				index_offset += fv;
-			}
-
-			// get material id
-			// Only try to read materials if the .mtl file is present
-			int a = shapes[s].mesh.material_ids.size();
-			if (a > 0 && materials.size()>0) {
-				materialId = shapes[s].mesh.material_ids[0];
-				if (materialId != -1) {
-					gps::Material currentMaterial;
-					currentMaterial.ambient = glm::vec3(materials[materialId].ambient[0], materials[materialId].ambient[1], materials[materialId].ambient[2]);
-					currentMaterial.diffuse = glm::vec3(materials[materialId].diffuse[0], materials[materialId].diffuse[1], materials[materialId].diffuse[2]);
-					currentMaterial.specular = glm::vec3(materials[materialId].specular[0], materials[materialId].specular[1], materials[materialId].specular[2]);
-
+				// get material id
+				// Only try to read materials if the .mtl file is present
+				int materialId = shape.materialId;
+				if (materialId != -1 && materialId < (int)materials.size()) {
 					//ambient texture
 					std::string ambientTexturePath = materials[materialId].ambient_texname;
 					if (!ambientTexturePath.empty())
@@ -130,10 +409,21 @@ namespace gps {
 						textures.push_back(currentTexture);
 					}
 				}
-			}
 
-			meshes.push_back(gps::Mesh(vertices, indices, textures));
+				meshes.push_back(gps::Mesh(std::move(vertices), std::move(indices), std::move(textures)));
+				meshes.back().bounds = shapeBounds;
+				bounds.extend(shapeBounds);
+			}
 		}
+
+		// every parser temporary above was an arena allocation instead of a heap allocation,
+		// and tinyobj::LoadObj would also have allocated a vector per face
+		size_t arenaAllocations = importArena.getAllocationCount();
+		log << "# of heap allocations avoided : " << arenaAllocations + faceCount << " (" << arenaAllocations
+			<< " in the arena, " << faceCount << " faces; " << importArena.getBytesAllocated() / 1024 << " KB in "
+			<< importArena.getBlocksAllocated() << " blocks)" << std::endl;
+		std::cout << log.str();
+		importArena.reset();
 	}
 
 	// Retrieves a texture associated with the object - by its name and type
@@ -148,7 +438,7 @@ namespace gps {
 			}
 
 			gps::Texture currentTexture;
-			currentTexture.id = ReadTextureFromFile(path.c_str());
+			currentTexture.id = 0;
 			currentTexture.type = std::string(type);
 			currentTexture.path = path;
 
@@ -157,15 +447,22 @@ namespace gps {
 			return currentTexture;
 		}
 
-	// Reads the pixel data from an image file and loads it into the video memory
-	GLuint Model3D::ReadTextureFromFile(const char* file_name) {
-		int x, y, n;
+	// Reads the pixel data from an image file
+	Model3D::TextureImage Model3D::ReadTextureFromFile(const char* file_name) {
+		TraceScope trace("Decode texture", "loading", file_name);
+		int x = 0, y = 0, n;
 		int force_channels = 4;
-		unsigned char* image_data = stbi_load(file_name, &x, &y, &n, force_channels);
+		std::vector<char> contents;
+		unsigned char* image_data = NULL;
+		if (readFile(file_name, contents)) {
+			image_data = stbi_load_from_memory((const stbi_uc*)contents.data(), (int)contents.size(), &x, &y, &n, force_channels);
+		}
+		TextureImage image = { x, y, image_data };
 		if (!image_data) {
 			fprintf(stderr, "ERROR: could not load %s\n", file_name);
-			return false;
+			return image;
 		}
+		MemoryTracker::shared().trackCpu(MEMORY_CPU_IMAGE, image_data, (size_t)x * y * 4, name, file_name);
 		// NPOT check
 		if ((x & (x - 1)) != 0 || (y & (y - 1)) != 0) {
 			fprintf(
@@ -191,6 +488,15 @@ namespace gps {
 			}
 		}
 
+		return image;
+	}
+
+	// Loads decoded pixels into the video memory and releases them
+	GLuint Model3D::UploadTexture(const TextureImage& image) {
+		if (!image.pixels) {
+			return 0;
+		}
+
 		GLuint textureID;
 		glGenTextures(1, &textureID);
 		glBindTexture(GL_TEXTURE_2D, textureID);
@@ -198,12 +504,12 @@ namespace gps {
 			GL_TEXTURE_2D,
 			0,
 			GL_SRGB, //GL_SRGB,//GL_RGBA,
-			x,
-			y,
+			image.width,
+			image.height,
 			0,
 			GL_RGBA,
 			GL_UNSIGNED_BYTE,
-			image_data
+			image.pixels
 		);
 		glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -212,12 +518,20 @@ namespace gps {
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		glBindTexture(GL_TEXTURE_2D, 0);
+		FreeTextureImage(image);
 
 		return textureID;
 	}
 
+	void Model3D::FreeTextureImage(const TextureImage& image) {
+		MemoryTracker::shared().releaseCpu(MEMORY_CPU_IMAGE, image.pixels);
+		stbi_image_free(image.pixels);
+	}
+
 	Model3D::~Model3D() {
+        MemoryTracker& memoryTracker = MemoryTracker::shared();
         for (size_t i = 0; i < loadedTextures.size(); i++) {
+            memoryTracker.release(MEMORY_TEXTURE, loadedTextures.at(i).id);
             glDeleteTextures(1, &loadedTextures.at(i).id);
         }
 
@@ -225,6 +539,9 @@ namespace gps {
             GLuint VBO = meshes.at(i).getBuffers().VBO;
             GLuint EBO = meshes.at(i).getBuffers().EBO;
             GLuint VAO = meshes.at(i).getBuffers().VAO;
+            memoryTracker.release(MEMORY_BUFFER, VBO);
+            memoryTracker.release(MEMORY_BUFFER, EBO);
+            memoryTracker.releaseCpu(MEMORY_CPU_GEOMETRY, &meshes.at(i));
             glDeleteBuffers(1, &VBO);
             glDeleteBuffers(1, &EBO);
             glDeleteVertexArrays(1, &VAO);
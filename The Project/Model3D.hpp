@@ -6,38 +6,92 @@
 #include "tiny_obj_loader.h"
 #include "stb_image.h"
 
+#include <atomic>
 #include <iostream>
 #include <string>
 #include <vector>
 
 namespace gps {
 
+    namespace benchmark {
+        struct EngineAccess;
+    }
+
     class Model3D
     {
 
     public:
+        Model3D();
         ~Model3D();
 
 		void LoadModel(std::string fileName);
 
 		void LoadModel(std::string fileName, std::string basePath);
 
-		void Draw(gps::Shader shaderProgram);
+		// CPU half of LoadModel: parses the .obj file and decodes the textures (as jobs),
+		// safe to call from any thread
+		void Import(std::string fileName);
+
+		void Import(std::string fileName, std::string basePath);
+
+		// GL half of LoadModel: creates the buffers and textures, on the context thread after Import
+		void Upload();
+
+		// Upload in two steps for streaming: the buffers and textures on any context sharing
+		// objects with the drawing one, then, once those uploads are visible, the vertex
+		// arrays on the drawing context
+		void UploadResources();
+
+		void SetupVertexArrays();
+
+		// Whether the model has been uploaded and can be drawn; its bounds and triangles
+		// are only safe to read from other threads once it is
+		bool isResident();
+
+		void Draw(gps::Shader& shaderProgram);
+
+		// Draw with per-mesh frustum and meshlet culling
+		void Draw(gps::Shader& shaderProgram, const MeshletCullParams& cullParams);
+
+		// Model space bounds of all meshes
+		BoundingBox getBounds();
+
+		// Model space positions of all triangles, three per triangle
+		std::vector<glm::vec3> getTriangles();
 
     private:
+		friend struct benchmark::EngineAccess;
+
+		// File the model was imported from, the owner of its memory in the MemoryTracker
+		std::string name;
 		// Component meshes - group of objects
         std::vector<gps::Mesh> meshes;
 		// Associated textures
         std::vector<gps::Texture> loadedTextures;
+		// Pixels decoded by Import, one per loaded texture, released by Upload
+		struct TextureImage {
+			int width;
+			int height;
+			unsigned char* pixels;
+		};
+		std::vector<TextureImage> textureImages;
+		// Union of the mesh bounds
+		BoundingBox bounds;
+		std::atomic<bool> resident;
 
 		// Does the parsing of the .obj file and fills in the data structure
 		void ReadOBJ(std::string fileName, std::string basePath);
 
-		// Retrieves a texture associated with the object - by its name and type
+		// Retrieves a texture associated with the object - by its name and type, decoded later by Import
 		gps::Texture LoadTexture(std::string path, std::string type);
 
-		// Reads the pixel data from an image file and loads it into the video memory
-		GLuint ReadTextureFromFile(const char* file_name);
+		// Reads the pixel data from an image file
+		TextureImage ReadTextureFromFile(const char* file_name);
+
+		// Loads decoded pixels into the video memory and releases them
+		GLuint UploadTexture(const TextureImage& image);
+
+		static void FreeTextureImage(const TextureImage& image);
     };
 }
 
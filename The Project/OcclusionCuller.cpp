@@ -0,0 +1,327 @@
+#include "OcclusionCuller.hpp"
+#include "JobSystem.hpp"
+#include "Simd.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace gps {
+
+    typedef std::chrono::high_resolution_clock Clock;
+
+    //vertices closer to the eye than this (clip w) make a triangle or a box unusable
+    static const float MIN_CLIP_W = 1e-4f;
+
+    //objects tested per worker chunk
+    static const size_t TEST_GRAIN = 64;
+
+    OccluderMesh OccluderMesh::fromBox(const BoundingBox& box, float scale) {
+        OccluderMesh mesh;
+        if (box.isEmpty()) {
+            return mesh;
+        }
+
+        glm::vec3 center = (box.minimum + box.maximum) * 0.5f;
+        glm::vec3 extent = (box.maximum - box.minimum) * 0.5f * scale;
+
+        //corner i takes the max of x, y, z for bits 0, 1, 2
+        glm::vec3 corners[8];
+        for (int i = 0; i < 8; i++) {
+            corners[i] = center + glm::vec3(
+                (i & 1) ? extent.x : -extent.x,
+                (i & 2) ? extent.y : -extent.y,
+                (i & 4) ? extent.z : -extent.z);
+        }
+
+        const int faces[6][4] = {
+            { 0, 2, 6, 4 }, { 1, 3, 7, 5 },
+            { 0, 1, 5, 4 }, { 2, 3, 7, 6 },
+            { 0, 1, 3, 2 }, { 4, 5, 7, 6 }
+        };
+
+        for (int f = 0; f < 6; f++) {
+            glm::vec3 a = corners[faces[f][0]];
+            glm::vec3 b = corners[faces[f][1]];
+            glm::vec3 c = corners[faces[f][2]];
+            glm::vec3 d = corners[faces[f][3]];
+
+            //wind every face counter clock-wise seen from outside
+            glm::vec3 faceCenter = (a + b + c + d) * 0.25f;
+            if (glm::dot(glm::cross(b - a, c - a), faceCenter - center) < 0.0f) {
+                std::swap(b, d);
+            }
+
+            mesh.triangles.push_back(a);
+            mesh.triangles.push_back(b);
+            mesh.triangles.push_back(c);
+            mesh.triangles.push_back(a);
+            mesh.triangles.push_back(c);
+            mesh.triangles.push_back(d);
+        }
+
+        return mesh;
+    }
+
+    OcclusionCuller::OcclusionCuller() {
+        depth.assign(WIDTH * HEIGHT, 1.0f);
+        tileDepth.assign((WIDTH / TILE_SIZE) * (HEIGHT / TILE_SIZE), 1.0f);
+        stats = OcclusionStats();
+    }
+
+    void OcclusionCuller::beginFrame(const glm::mat4& viewProjectionMatrix) {
+        viewProjection = viewProjectionMatrix;
+        screenTriangles.clear();
+        stats = OcclusionStats();
+    }
+
+    void OcclusionCuller::addOccluder(const OccluderMesh& occluder, const glm::mat4& modelMatrix) {
+        Clock::time_point start = Clock::now();
+        glm::mat4 transform = viewProjection * modelMatrix;
+        stats.occluders++;
+
+        for (size_t i = 0; i + 2 < occluder.triangles.size(); i += 3) {
+            ScreenTriangle triangle;
+            glm::vec3* screen[3] = { &triangle.v0, &triangle.v1, &triangle.v2 };
+
+            bool usable = true;
+            for (int v = 0; v < 3 && usable; v++) {
+                glm::vec4 clip = transform * glm::vec4(occluder.triangles[i + v], 1.0f);
+                if (clip.w <= MIN_CLIP_W) {
+                    usable = false;
+                    break;
+                }
+                *screen[v] = glm::vec3(
+                    (clip.x / clip.w * 0.5f + 0.5f) * WIDTH,
+                    (clip.y / clip.w * 0.5f + 0.5f) * HEIGHT,
+                    clip.z / clip.w * 0.5f + 0.5f);
+            }
+            if (!usable) {
+                continue;
+            }
+
+            //back faces are culled by OpenGL as well, so they cannot hide anything
+            float area = (triangle.v1.x - triangle.v0.x) * (triangle.v2.y - triangle.v0.y)
+                - (triangle.v2.x - triangle.v0.x) * (triangle.v1.y - triangle.v0.y);
+            if (area <= 0.0f) {
+                continue;
+            }
+
+            screenTriangles.push_back(triangle);
+        }
+
+        stats.triangles = (unsigned int)screenTriangles.size();
+        stats.rasterizeMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    void OcclusionCuller::rasterize() {
+        Clock::time_point start = Clock::now();
+
+        //tiles read one pixel past their band, so all bands are rasterized first
+        const int bandCount = HEIGHT / BAND_HEIGHT;
+        JobSystem::shared().parallelFor(bandCount, 1, [this](size_t begin, size_t end) {
+            for (size_t band = begin; band < end; band++) {
+                int firstRow = (int)band * BAND_HEIGHT;
+                rasterizeBand(firstRow, firstRow + BAND_HEIGHT);
+            }
+        });
+        JobSystem::shared().parallelFor(bandCount, 1, [this](size_t begin, size_t end) {
+            for (size_t band = begin; band < end; band++) {
+                int firstRow = (int)band * BAND_HEIGHT;
+                buildTileDepth(firstRow, firstRow + BAND_HEIGHT);
+            }
+        });
+
+        stats.rasterizeMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    void OcclusionCuller::rasterizeBand(int firstRow, int endRow) {
+        std::fill(depth.begin() + firstRow * WIDTH, depth.begin() + endRow * WIDTH, 1.0f);
+
+        for (size_t i = 0; i < screenTriangles.size(); i++) {
+            rasterizeTriangle(screenTriangles[i], firstRow, endRow);
+        }
+    }
+
+    void OcclusionCuller::rasterizeTriangle(const ScreenTriangle& t, int firstRow, int endRow) {
+        float minX = std::min(t.v0.x, std::min(t.v1.x, t.v2.x));
+        float maxX = std::max(t.v0.x, std::max(t.v1.x, t.v2.x));
+        float minY = std::min(t.v0.y, std::min(t.v1.y, t.v2.y));
+        float maxY = std::max(t.v0.y, std::max(t.v1.y, t.v2.y));
+
+        int x0 = std::max(0, (int)std::floor(minX));
+        int x1 = std::min(WIDTH - 1, (int)std::ceil(maxX));
+        int y0 = std::max(firstRow, (int)std::floor(minY));
+        int y1 = std::min(endRow - 1, (int)std::ceil(maxY));
+        if (x0 > x1 || y0 > y1) {
+            return;
+        }
+        x0 &= ~3;
+
+        //edge functions A * x + B * y + C, positive inside a counter clock-wise triangle
+        const glm::vec3* v[3] = { &t.v0, &t.v1, &t.v2 };
+        float edgeA[3], edgeB[3], edgeC[3];
+        for (int e = 0; e < 3; e++) {
+            const glm::vec3& a = *v[e];
+            const glm::vec3& b = *v[(e + 1) % 3];
+            edgeA[e] = a.y - b.y;
+            edgeB[e] = b.x - a.x;
+            edgeC[e] = a.x * b.y - a.y * b.x;
+        }
+
+        //depth plane z = z0 + dzdx * x + dzdy * y
+        glm::vec3 d1 = t.v1 - t.v0;
+        glm::vec3 d2 = t.v2 - t.v0;
+        float determinant = d1.x * d2.y - d2.x * d1.y;
+        float dzdx = (d1.z * d2.y - d2.z * d1.y) / determinant;
+        float dzdy = (d2.z * d1.x - d1.z * d2.x) / determinant;
+        float z0 = t.v0.z - dzdx * t.v0.x - dzdy * t.v0.y;
+
+        for (int y = y0; y <= y1; y++) {
+            float py = (float)y + 0.5f;
+            float* row = &depth[y * WIDTH];
+
+#if defined(GPS_SIMD_SSE)
+            __m128 rowE[3];
+            __m128 stepA[3];
+            __m128 zero = _mm_setzero_ps();
+            for (int e = 0; e < 3; e++) {
+                rowE[e] = _mm_set1_ps(edgeB[e] * py + edgeC[e]);
+                stepA[e] = _mm_set1_ps(edgeA[e]);
+            }
+            __m128 rowZ = _mm_set1_ps(z0 + dzdy * py);
+            __m128 slopeZ = _mm_set1_ps(dzdx);
+            __m128 lane = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+
+            for (int x = x0; x <= x1; x += 4) {
+                __m128 px = _mm_add_ps(_mm_set1_ps((float)x), lane);
+                __m128 inside = _mm_cmpge_ps(_mm_add_ps(rowE[0], _mm_mul_ps(stepA[0], px)), zero);
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(rowE[1], _mm_mul_ps(stepA[1], px)), zero));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(rowE[2], _mm_mul_ps(stepA[2], px)), zero));
+                if (_mm_movemask_ps(inside) == 0) {
+                    continue;
+                }
+
+                __m128 z = _mm_add_ps(rowZ, _mm_mul_ps(slopeZ, px));
+                __m128 current = _mm_loadu_ps(row + x);
+                __m128 nearest = _mm_min_ps(current, z);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+            }
+#else
+            for (int x = x0; x <= x1; x++) {
+                float px = (float)x + 0.5f;
+                bool inside = true;
+                for (int e = 0; e < 3 && inside; e++) {
+                    inside = edgeA[e] * px + edgeB[e] * py + edgeC[e] >= 0.0f;
+                }
+                if (inside) {
+                    row[x] = std::min(row[x], z0 + dzdx * px + dzdy * py);
+                }
+            }
+#endif
+        }
+    }
+
+    void OcclusionCuller::buildTileDepth(int firstRow, int endRow) {
+        const int tilesPerRow = WIDTH / TILE_SIZE;
+
+        for (int tileY = firstRow / TILE_SIZE; tileY < endRow / TILE_SIZE; tileY++) {
+            int y0 = std::max(0, tileY * TILE_SIZE - 1);
+            int y1 = std::min(HEIGHT - 1, (tileY + 1) * TILE_SIZE);
+
+            for (int tileX = 0; tileX < tilesPerRow; tileX++) {
+                int x0 = std::max(0, tileX * TILE_SIZE - 1);
+                int x1 = std::min(WIDTH - 1, (tileX + 1) * TILE_SIZE);
+
+                float farthest = 0.0f;
+                for (int y = y0; y <= y1; y++) {
+                    const float* row = &depth[y * WIDTH];
+                    for (int x = x0; x <= x1; x++) {
+                        farthest = std::max(farthest, row[x]);
+                    }
+                }
+                tileDepth[tileY * tilesPerRow + tileX] = farthest;
+            }
+        }
+    }
+
+    bool OcclusionCuller::isVisible(const BoundingBox& box) {
+        if (box.isEmpty()) {
+            return true;
+        }
+
+        float minX = INFINITY, minY = INFINITY, minZ = INFINITY;
+        float maxX = -INFINITY, maxY = -INFINITY;
+        for (int i = 0; i < 8; i++) {
+            glm::vec3 corner(
+                (i & 1) ? box.maximum.x : box.minimum.x,
+                (i & 2) ? box.maximum.y : box.minimum.y,
+                (i & 4) ? box.maximum.z : box.minimum.z);
+            glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+
+            //the box reaches the eye, nothing can be in front of it
+            if (clip.w <= MIN_CLIP_W) {
+                return true;
+            }
+
+            float x = (clip.x / clip.w * 0.5f + 0.5f) * WIDTH;
+            float y = (clip.y / clip.w * 0.5f + 0.5f) * HEIGHT;
+            float z = clip.z / clip.w * 0.5f + 0.5f;
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+            minY = std::min(minY, y);
+            maxY = std::max(maxY, y);
+            minZ = std::min(minZ, z);
+        }
+
+        //outside the screen is the frustum culling's business
+        if (maxX < 0.0f || maxY < 0.0f || minX >= WIDTH || minY >= HEIGHT) {
+            return true;
+        }
+
+        const int tilesPerRow = WIDTH / TILE_SIZE;
+        int tileX0 = std::max(0, (int)minX) / TILE_SIZE;
+        int tileX1 = std::min(WIDTH - 1, (int)maxX) / TILE_SIZE;
+        int tileY0 = std::max(0, (int)minY) / TILE_SIZE;
+        int tileY1 = std::min(HEIGHT - 1, (int)maxY) / TILE_SIZE;
+
+        for (int tileY = tileY0; tileY <= tileY1; tileY++) {
+            for (int tileX = tileX0; tileX <= tileX1; tileX++) {
+                if (minZ <= tileDepth[tileY * tilesPerRow + tileX]) {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    unsigned int OcclusionCuller::cull(const std::vector<BoundingBox>& worldBounds, std::vector<unsigned int>& objects) {
+        Clock::time_point start = Clock::now();
+
+        visibleFlags.resize(objects.size());
+        JobSystem::shared().parallelFor(objects.size(), TEST_GRAIN, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                visibleFlags[i] = isVisible(worldBounds[objects[i]]);
+            }
+        });
+
+        size_t kept = 0;
+        for (size_t i = 0; i < objects.size(); i++) {
+            if (visibleFlags[i]) {
+                objects[kept++] = objects[i];
+            }
+        }
+        unsigned int occluded = (unsigned int)(objects.size() - kept);
+        objects.resize(kept);
+
+        stats.tested += (unsigned int)visibleFlags.size();
+        stats.occluded += occluded;
+        stats.testMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        return occluded;
+    }
+
+    OcclusionStats OcclusionCuller::getStats() {
+        return stats;
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef OcclusionCuller_hpp
+#define OcclusionCuller_hpp
+
+#include <glm/glm.hpp>
+
+#include "Frustum.hpp"
+
+#include <vector>
+
+namespace gps {
+
+    // Simplified geometry used to hide other objects: a counter clock-wise triangle list in model space
+    struct OccluderMesh
+    {
+        std::vector<glm::vec3> triangles;
+
+        //closed box around the center of the given box, scaled so that it stays inside the real object
+        static OccluderMesh fromBox(const BoundingBox& box, float scale);
+    };
+
+    struct OcclusionStats
+    {
+        unsigned int occluders;
+        unsigned int triangles;
+        unsigned int tested;
+        unsigned int occluded;
+        double rasterizeMs;
+        double testMs;
+    };
+
+    // Software occlusion culling: occluders are rasterized on the CPU into a small depth
+    // buffer (SSE, one band of rows per worker), reduced to a tile max depth buffer, and
+    // object bounds are then tested against the tiles they cover.
+    // Pixels are sampled at their centers; every tile also takes the farthest depth of the
+    // pixels bordering it, so partially covered edge pixels never hide an object.
+    class OcclusionCuller
+    {
+    public:
+        static const int WIDTH = 256;
+        static const int HEIGHT = 128;
+        static const int TILE_SIZE = 8;
+        static const int BAND_HEIGHT = 16;
+
+        OcclusionCuller();
+
+        //clears the depth buffer for a new view
+        void beginFrame(const glm::mat4& viewProjection);
+
+        //projects the occluder triangles, back faces and triangles crossing the near plane are skipped
+        void addOccluder(const OccluderMesh& occluder, const glm::mat4& modelMatrix);
+
+        //rasterizes all occluders and builds the tile depth buffer
+        void rasterize();
+
+        //removes the objects whose world bounds are hidden from the list, returns how many were removed
+        unsigned int cull(const std::vector<BoundingBox>& worldBounds, std::vector<unsigned int>& objects);
+
+        bool isVisible(const BoundingBox& worldBox);
+
+        OcclusionStats getStats();
+
+    private:
+        struct ScreenTriangle {
+            glm::vec3 v0, v1, v2;
+        };
+
+        glm::mat4 viewProjection;
+        std::vector<ScreenTriangle> screenTriangles;
+        std::vector<float> depth;
+        std::vector<float> tileDepth;
+        std::vector<unsigned char> visibleFlags;
+        OcclusionStats stats;
+
+        void rasterizeBand(int firstRow, int endRow);
+        void rasterizeTriangle(const ScreenTriangle& triangle, int firstRow, int endRow);
+        void buildTileDepth(int firstRow, int endRow);
+    };
+}
+
+#endif /* OcclusionCuller_hpp */
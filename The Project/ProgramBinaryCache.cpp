@@ -0,0 +1,181 @@
+#include "ProgramBinaryCache.hpp"
+#include "FileIO.hpp"
+#include "Trace.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace gps {
+
+    static const char MAGIC[4] = { 'G', 'P', 'S', 'B' };
+
+    struct ProgramBinaryHeader {
+        char magic[4];
+        unsigned int version;
+        unsigned long long key;
+        GLenum format;
+        unsigned int length;
+    };
+
+    //64 bit FNV-1a
+    static const unsigned long long HASH_BASIS = 14695981039346656037ULL;
+
+    static unsigned long long hashBytes(unsigned long long hash, const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    static unsigned long long hashString(unsigned long long hash, const std::string& text) {
+        //the terminator keeps "ab" + "c" apart from "a" + "bc"
+        return hashBytes(hash, text.c_str(), text.size() + 1);
+    }
+
+    static std::string glString(GLenum name) {
+        const GLubyte* value = glGetString(name);
+        return value != NULL ? std::string(reinterpret_cast<const char*>(value)) : std::string();
+    }
+
+    ProgramBinaryCache::ProgramBinaryCache() : enabled(true), checked(false), driverHash(HASH_BASIS), hits(0), misses(0), rejected(0) {
+    }
+
+    ProgramBinaryCache& ProgramBinaryCache::shared() {
+        static ProgramBinaryCache cache;
+        return cache;
+    }
+
+    void ProgramBinaryCache::setEnabled(bool enabled) {
+        this->enabled = enabled;
+    }
+
+    bool ProgramBinaryCache::isEnabled() {
+        return enabled;
+    }
+
+    bool ProgramBinaryCache::isUsable() {
+        if (!enabled) {
+            return false;
+        }
+        if (!checked) {
+            checked = true;
+            GLint formats = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            if (formats == 0) {
+                std::cout << "No program binary formats, shaders are compiled at every start" << std::endl;
+                enabled = false;
+                return false;
+            }
+            unsigned int version = FORMAT_VERSION;
+            driverHash = hashBytes(driverHash, &version, sizeof(version));
+            driverHash = hashString(driverHash, glString(GL_VENDOR));
+            driverHash = hashString(driverHash, glString(GL_RENDERER));
+            driverHash = hashString(driverHash, glString(GL_VERSION));
+            driverHash = hashString(driverHash, glString(GL_SHADING_LANGUAGE_VERSION));
+        }
+        return true;
+    }
+
+    std::string ProgramBinaryCache::path(const std::string& vertexShaderFileName) {
+        if (!isUsable()) {
+            return std::string();
+        }
+        char driver[24];
+        snprintf(driver, sizeof(driver), ".%016llx", driverHash);
+        size_t extension = vertexShaderFileName.find_last_of('.');
+        return vertexShaderFileName.substr(0, extension) + driver + ".program";
+    }
+
+    unsigned long long ProgramBinaryCache::key(const std::string& vertexSource, const std::string& fragmentSource) {
+        if (!isUsable()) {
+            return 0;
+        }
+        return hashString(hashString(driverHash, vertexSource), fragmentSource);
+    }
+
+    GLuint ProgramBinaryCache::load(const std::string& vertexShaderFileName, unsigned long long key) {
+        if (!isUsable()) {
+            return 0;
+        }
+
+        std::string path = this->path(vertexShaderFileName);
+        std::vector<char> contents;
+        ProgramBinaryHeader header;
+        if (!readFile(path, contents) || contents.size() < sizeof(header)) {
+            misses++;
+            return 0;
+        }
+        memcpy(&header, contents.data(), sizeof(header));
+        if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != FORMAT_VERSION || header.key != key
+            || contents.size() != sizeof(header) + header.length) {
+            misses++;
+            return 0;
+        }
+
+        //detailed by the shader, so that the startup report counts the upload for it
+        TraceScope trace("Upload program binary", "shader", vertexShaderFileName.c_str());
+        GLuint program = glCreateProgram();
+        glProgramBinary(program, header.format, contents.data() + sizeof(header), (GLsizei)header.length);
+        //a driver update may not take its older binaries, without changing its version string
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            glDeleteProgram(program);
+            rejected++;
+            return 0;
+        }
+        hits++;
+        return program;
+    }
+
+    void ProgramBinaryCache::prepare(GLuint program) {
+        if (isUsable()) {
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+    }
+
+    void ProgramBinaryCache::store(const std::string& vertexShaderFileName, unsigned long long key, GLuint program) {
+        if (!isUsable()) {
+            return;
+        }
+        std::string path = this->path(vertexShaderFileName);
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) {
+            return;
+        }
+
+        ProgramBinaryHeader header;
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = FORMAT_VERSION;
+        header.key = key;
+        std::vector<char> contents(sizeof(header) + length);
+        GLsizei written = 0;
+        glGetProgramBinary(program, length, &written, &header.format, contents.data() + sizeof(header));
+        header.length = (unsigned int)written;
+        memcpy(contents.data(), &header, sizeof(header));
+
+        //a file cut short by a failed write does not pass the length check of load
+        FILE* file = fopen(path.c_str(), "wb");
+        if (file == NULL) {
+            std::cerr << "Could not write the program binary " << path << std::endl;
+            return;
+        }
+        fwrite(contents.data(), 1, sizeof(header) + header.length, file);
+        fclose(file);
+    }
+
+    void ProgramBinaryCache::printSummary(std::ostream& out) {
+        if (!enabled) {
+            return;
+        }
+        out << "Program binaries: " << hits << " loaded, " << misses + rejected << " compiled";
+        if (rejected > 0) {
+            out << " (" << rejected << " rejected by the driver)";
+        }
+        out << std::endl;
+    }
+}
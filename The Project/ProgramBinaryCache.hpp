@@ -0,0 +1,57 @@
+#ifndef ProgramBinaryCache_hpp
+#define ProgramBinaryCache_hpp
+
+#include <GL/glew.h>
+
+#include <ostream>
+#include <string>
+
+namespace gps {
+
+    // Linked shader programs kept as driver binaries (glGetProgramBinary, core in 4.1), so that
+    // a warm start links every program from its binary instead of compiling GLSL. An entry is
+    // a file per program and driver, named after a hash of the vendor, renderer and version
+    // strings, so that switching between GPUs keeps both binaries. The file holds its key, a
+    // hash of the shader sources and the driver: edited shaders miss and are compiled again,
+    // as are binaries the driver rejects. Only on the context thread.
+    class ProgramBinaryCache
+    {
+    public:
+        //bumped when the file layout changes
+        static const unsigned int FORMAT_VERSION = 1;
+
+        static ProgramBinaryCache& shared();
+
+        //on by default; off, or when the driver has no binary formats, every program is compiled
+        void setEnabled(bool enabled);
+        bool isEnabled();
+
+        unsigned long long key(const std::string& vertexSource, const std::string& fragmentSource);
+
+        //programs are named by their vertex shader, the file lives next to it:
+        //shaders/basic.vert is cached as shaders/basic.<driver hash>.program
+
+        //a linked program, 0 when the file is missing, stale or rejected
+        GLuint load(const std::string& vertexShaderFileName, unsigned long long key);
+        //before linking a program that is going to be stored
+        void prepare(GLuint program);
+        void store(const std::string& vertexShaderFileName, unsigned long long key, GLuint program);
+
+        //programs loaded from binaries and compiled, nothing when the cache is off
+        void printSummary(std::ostream& out);
+
+    private:
+        bool enabled;
+        bool checked;
+        unsigned long long driverHash;
+        unsigned int hits;
+        unsigned int misses;
+        unsigned int rejected;
+
+        ProgramBinaryCache();
+        bool isUsable();
+        std::string path(const std::string& vertexShaderFileName);
+    };
+}
+
+#endif /* ProgramBinaryCache_hpp */
@@ -1,25 +1,18 @@
 #include "Shader.hpp"
+#include "FileIO.hpp"
+#include "GLStats.hpp"
+#include "ProgramBinaryCache.hpp"
+#include "Trace.hpp"
 
 namespace gps {
     std::string Shader::readShaderFile(std::string fileName)
     {
-        std::ifstream shaderFile;
-        std::string shaderString;
+        //read the whole shader file, empty when it cannot be read
+        std::vector<char> shaderContents;
+        readFile(fileName, shaderContents);
 
-        //open shader file
-        shaderFile.open(fileName.c_str());
-
-        std::stringstream shaderStringStream;
-
-        //read shader content into stream
-        shaderStringStream << shaderFile.rdbuf();
-
-        //close shader file
-        shaderFile.close();
-
-        //convert stream into GLchar array
-        shaderString = shaderStringStream.str();
-        return shaderString;
+        //convert into GLchar array
+        return std::string(shaderContents.begin(), shaderContents.end());
     }
 
     void Shader::shaderCompileLog(GLuint shaderId)
@@ -36,7 +29,7 @@ namespace gps {
         }
     }
 
-    void Shader::shaderLinkLog(GLuint shaderProgramId)
+    bool Shader::shaderLinkLog(GLuint shaderProgramId)
     {
         GLint success;
         GLchar infoLog[512];
@@ -47,12 +40,26 @@ namespace gps {
             glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
             std::cout << "Shader linking error\n" << infoLog << std::endl;
         }
+        return success == GL_TRUE;
     }
 
     void Shader::loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName)
     {
-        //read, parse and compile the vertex shader
         std::string v = readShaderFile(vertexShaderFileName);
+        std::string f = readShaderFile(fragmentShaderFileName);
+
+        //the binary of the last start, when neither the sources nor the driver changed
+        ProgramBinaryCache& cache = ProgramBinaryCache::shared();
+        unsigned long long cacheKey = cache.key(v, f);
+        this->shaderProgram = cache.load(vertexShaderFileName, cacheKey);
+        if (this->shaderProgram != 0) {
+            return;
+        }
+
+        //only a miss compiles, a warm start shows no compile time
+        TraceScope trace("Compile shader", "shader", vertexShaderFileName.c_str());
+
+        //parse and compile the vertex shader
         const GLchar* vertexShaderString = v.c_str();
         GLuint vertexShader;
         vertexShader = glCreateShader(GL_VERTEX_SHADER);
@@ -61,8 +68,7 @@ namespace gps {
         //check compilation status
         shaderCompileLog(vertexShader);
 
-        //read, parse and compile the vertex shader
-        std::string f = readShaderFile(fragmentShaderFileName);
+        //parse and compile the fragment shader
         const GLchar* fragmentShaderString = f.c_str();
         GLuint fragmentShader;
         fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
@@ -75,16 +81,19 @@ namespace gps {
         this->shaderProgram = glCreateProgram();
         glAttachShader(this->shaderProgram, vertexShader);
         glAttachShader(this->shaderProgram, fragmentShader);
+        cache.prepare(this->shaderProgram);
         glLinkProgram(this->shaderProgram);
         glDeleteShader(vertexShader);
         glDeleteShader(fragmentShader);
         //check linking info
-        shaderLinkLog(this->shaderProgram);
+        if (shaderLinkLog(this->shaderProgram)) {
+            cache.store(vertexShaderFileName, cacheKey, this->shaderProgram);
+        }
     }
 
     void Shader::useShaderProgram()
     {
-        glUseProgram(this->shaderProgram);
+        gl::useProgram(this->shaderProgram);
     }
 
 }
@@ -21,7 +21,8 @@ public:
 private:
     std::string readShaderFile(std::string fileName);
     void shaderCompileLog(GLuint shaderId);
-    void shaderLinkLog(GLuint shaderProgramId);
+    //true when the program linked
+    bool shaderLinkLog(GLuint shaderProgramId);
 };
 
 }
@@ -0,0 +1,20 @@
+#ifndef Simd_hpp
+#define Simd_hpp
+
+// SIMD instruction set selection shared by the CPU culling and transform code.
+// GPS_SIMD_SSE is set whenever SSE2 is available (always on x64), GPS_SIMD_AVX2
+// only when the compiler targets AVX2 (/arch:AVX2 or -mavx2).
+// Define GPS_SIMD_DISABLE to force the scalar fallbacks.
+
+#if !defined(GPS_SIMD_DISABLE)
+    #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define GPS_SIMD_SSE 1
+        #include <emmintrin.h>
+    #endif
+    #if defined(__AVX2__)
+        #define GPS_SIMD_AVX2 1
+        #include <immintrin.h>
+    #endif
+#endif
+
+#endif /* Simd_hpp */
@@ -7,6 +7,10 @@
 //
 
 #include "SkyBox.hpp"
+#include "FileIO.hpp"
+#include "GLStats.hpp"
+#include "MemoryTracker.hpp"
+#include "Trace.hpp"
 
 namespace gps {
     
@@ -21,25 +25,25 @@ namespace gps {
         InitSkyBox();
     }
     
-    void SkyBox::Draw(gps::Shader shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix)
+    void SkyBox::Draw(gps::Shader& shader, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)
     {
         shader.useShaderProgram();
         
         //set the view and projection matrices
         glm::mat4 transformedView = glm::mat4(glm::mat3(viewMatrix));
-        glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(transformedView));
-        glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+        gl::uniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(transformedView));
+        gl::uniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projectionMatrix));
         
-        glDepthFunc(GL_LEQUAL);
+        gl::depthFunc(GL_LEQUAL);
         
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glUniform1i(glGetUniformLocation(shader.shaderProgram, "skybox"), 0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
+        gl::bindVertexArray(skyboxVAO);
+        gl::activeTexture(GL_TEXTURE0);
+        gl::uniform1i(glGetUniformLocation(shader.shaderProgram, "skybox"), 0);
+        gl::bindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+        gl::drawArrays(GL_TRIANGLES, 0, 36);
+        gl::bindVertexArray(0);
         
-        glDepthFunc(GL_LESS);
+        gl::depthFunc(GL_LESS);
     }
     
     GLuint SkyBox::LoadSkyBoxTextures(std::vector<const GLchar*> skyBoxFaces)
@@ -55,16 +59,30 @@ namespace gps {
         glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
         for(GLuint i = 0; i < skyBoxFaces.size(); i++)
         {
-            image = stbi_load(skyBoxFaces[i], &width, &height, &n, force_channels);
+            {
+                TraceScope trace("Decode texture", "loading", skyBoxFaces[i]);
+                std::vector<char> contents;
+                image = NULL;
+                if (readFile(skyBoxFaces[i], contents)) {
+                    image = stbi_load_from_memory((const stbi_uc*)contents.data(), (int)contents.size(), &width, &height, &n, force_channels);
+                }
+            }
             if (!image) {
                 fprintf(stderr, "ERROR: could not load %s\n", skyBoxFaces[i]);
                 return false;
             }
-            glTexImage2D(
-                         GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0,
-                         GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image
-                         );
+            MemoryTracker::shared().trackCpu(MEMORY_CPU_IMAGE, image, (size_t)width * height * 3, "Skybox", skyBoxFaces[i]);
+            {
+                TraceScope trace("Upload texture", "loading", skyBoxFaces[i]);
+                glTexImage2D(
+                             GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0,
+                             GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image
+                             );
+            }
+            MemoryTracker::shared().releaseCpu(MEMORY_CPU_IMAGE, image);
+            stbi_image_free(image);
         }
+        MemoryTracker::shared().trackTexture(textureID, GL_RGB, width, height, 6, 1, "Skybox", "cubemap");
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -127,6 +145,7 @@ namespace gps {
         glBindVertexArray(skyboxVAO);
         glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
+        MemoryTracker::shared().trackBuffer(skyboxVBO, sizeof(skyboxVertices), "Skybox", "cube vertices");
         
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
@@ -17,14 +17,20 @@
 #include "glm/gtc/type_ptr.hpp"
 
 namespace gps {
+    namespace benchmark {
+        struct EngineAccess;
+    }
+
     class SkyBox
     {
     public:
         SkyBox();
         void Load(std::vector<const GLchar*> cubeMapFaces);
-        void Draw(gps::Shader shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix);
+        void Draw(gps::Shader& shader, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix);
         GLuint GetTextureId();
     private:
+        friend struct benchmark::EngineAccess;
+
         GLuint skyboxVAO;
         GLuint skyboxVBO;
         GLuint cubemapTexture;
@@ -0,0 +1,214 @@
+#include "StartupReport.hpp"
+#include "Json.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+namespace gps {
+
+    static const char* WORK_NAMES[LOAD_WORK_COUNT] = { "io", "parse", "decode", "upload", "compile", "other" };
+
+    static bool isLoadingCategory(const char* category) {
+        return strcmp(category, "startup") == 0 || strcmp(category, "loading") == 0
+            || strcmp(category, "io") == 0 || strcmp(category, "shader") == 0;
+    }
+
+    static LOAD_WORK workOf(const char* name) {
+        if (strcmp(name, "Read file") == 0) {
+            return LOAD_IO;
+        }
+        if (strcmp(name, "Parse OBJ") == 0) {
+            return LOAD_PARSE;
+        }
+        if (strcmp(name, "Decode texture") == 0) {
+            return LOAD_DECODE;
+        }
+        if (strncmp(name, "Upload ", 7) == 0 || strcmp(name, "Setup vertex arrays") == 0) {
+            return LOAD_UPLOAD;
+        }
+        if (strcmp(name, "Compile shader") == 0) {
+            return LOAD_COMPILE;
+        }
+        return LOAD_OTHER;
+    }
+
+    static const char* assetType(const std::string& path) {
+        std::string extension = path.substr(path.find_last_of('.') + 1);
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (extension == "obj") {
+            return "model";
+        }
+        //program binaries are cached shaders
+        if (extension == "vert" || extension == "frag" || extension == "program") {
+            return "shader";
+        }
+        if (extension == "png" || extension == "jpg" || extension == "jpeg" || extension == "tga" || extension == "bmp") {
+            return "texture";
+        }
+        return "file";
+    }
+
+    void StartupReport::build() {
+        std::vector<trace::Record> records;
+        trace::collect(records);
+        records.erase(std::remove_if(records.begin(), records.end(), [](const trace::Record& record) {
+            return !isLoadingCategory(record.category);
+        }), records.end());
+
+        //the enclosing scope of every record and its time without the nested scopes; records
+        //come thread after thread in the order they began
+        const size_t NONE = (size_t)-1;
+        std::vector<size_t> parents(records.size(), NONE);
+        std::vector<double> selfTimes(records.size());
+        std::vector<size_t> open;
+        for (size_t i = 0; i < records.size(); i++) {
+            const trace::Record& record = records[i];
+            if (i > 0 && records[i - 1].thread != record.thread) {
+                open.clear();
+            }
+            while (!open.empty() && records[open.back()].start + records[open.back()].duration <= record.start) {
+                open.pop_back();
+            }
+            selfTimes[i] = record.duration;
+            if (!open.empty()) {
+                parents[i] = open.back();
+                selfTimes[open.back()] -= record.duration;
+            }
+            open.push_back(i);
+        }
+
+        //the main thread is the one of the first startup scope
+        unsigned int mainThread = 0;
+        double firstStart = -1.0;
+        for (size_t i = 0; i < records.size(); i++) {
+            if (strcmp(records[i].category, "startup") == 0 && (firstStart < 0.0 || records[i].start < firstStart)) {
+                mainThread = records[i].thread;
+                firstStart = records[i].start;
+            }
+        }
+
+        phases.clear();
+        assets.clear();
+        std::fill(totals, totals + LOAD_WORK_COUNT, 0.0);
+        totalTime = 0.0;
+        std::map<size_t, size_t> phaseOfRecord;
+        std::map<std::string, size_t> assetOfPath;
+        for (size_t i = 0; i < records.size(); i++) {
+            const trace::Record& record = records[i];
+            double start = record.start / 1000.0;
+            double end = (record.start + record.duration) / 1000.0;
+            LOAD_WORK work = workOf(record.name);
+            double selfTime = std::max(selfTimes[i], 0.0) / 1000.0;
+            totals[work] += selfTime;
+            totalTime = std::max(totalTime, end);
+
+            size_t root = i;
+            while (parents[root] != NONE) {
+                root = parents[root];
+            }
+            if (root == i && record.thread == mainThread && strcmp(record.category, "startup") == 0) {
+                Phase phase;
+                phase.name = record.name;
+                phase.start = start;
+                phase.duration = record.duration / 1000.0;
+                std::fill(phase.work, phase.work + LOAD_WORK_COUNT, 0.0);
+                phaseOfRecord[i] = phases.size();
+                phases.push_back(phase);
+            }
+            std::map<size_t, size_t>::iterator phase = phaseOfRecord.find(root);
+            if (phase != phaseOfRecord.end()) {
+                phases[phase->second].work[work] += selfTime;
+            }
+
+            //a scope without detail works on the asset of the scope around it
+            size_t owner = i;
+            while (owner != NONE && records[owner].detail.empty()) {
+                owner = parents[owner];
+            }
+            if (owner == NONE) {
+                continue;
+            }
+            const std::string& path = records[owner].detail;
+            std::map<std::string, size_t>::iterator found = assetOfPath.find(path);
+            if (found == assetOfPath.end()) {
+                Asset asset;
+                asset.path = path;
+                asset.type = assetType(path);
+                asset.start = start;
+                asset.ready = end;
+                std::fill(asset.work, asset.work + LOAD_WORK_COUNT, 0.0);
+                found = assetOfPath.insert(std::make_pair(path, assets.size())).first;
+                assets.push_back(asset);
+            }
+            Asset& asset = assets[found->second];
+            asset.start = std::min(asset.start, start);
+            asset.ready = std::max(asset.ready, end);
+            asset.work[work] += selfTime;
+        }
+
+        std::sort(assets.begin(), assets.end(), [](const Asset& a, const Asset& b) {
+            return a.start < b.start;
+        });
+    }
+
+    static void writeWork(FILE* file, const double* work) {
+        for (int kind = 0; kind < LOAD_WORK_COUNT; kind++) {
+            fprintf(file, "%s\"%s_ms\": %.3f", kind > 0 ? ", " : "", WORK_NAMES[kind], work[kind]);
+        }
+    }
+
+    bool StartupReport::writeJson(const std::string& path) {
+        FILE* file = fopen(path.c_str(), "w");
+        if (file == NULL) {
+            return false;
+        }
+
+        json::beginReport(file);
+        fprintf(file, ",\n  \"total_ms\": %.3f,\n  \"work\": {", totalTime);
+        writeWork(file, totals);
+        fprintf(file, "},\n");
+
+        fprintf(file, "  \"phases\": [");
+        for (size_t i = 0; i < phases.size(); i++) {
+            const Phase& phase = phases[i];
+            fprintf(file, "%s\n    {\"name\": ", i > 0 ? "," : "");
+            json::writeString(file, phase.name);
+            fprintf(file, ", \"start_ms\": %.3f, \"duration_ms\": %.3f, ", phase.start, phase.duration);
+            writeWork(file, phase.work);
+            fprintf(file, "}");
+        }
+        fprintf(file, "\n  ],\n");
+
+        fprintf(file, "  \"assets\": [");
+        for (size_t i = 0; i < assets.size(); i++) {
+            const Asset& asset = assets[i];
+            double busy = 0.0;
+            for (int kind = 0; kind < LOAD_WORK_COUNT; kind++) {
+                busy += asset.work[kind];
+            }
+            fprintf(file, "%s\n    {\"path\": ", i > 0 ? "," : "");
+            json::writeString(file, asset.path);
+            fprintf(file, ", \"type\": \"%s\", \"start_ms\": %.3f, \"ready_ms\": %.3f, \"total_ms\": %.3f, ",
+                asset.type, asset.start, asset.ready, busy);
+            writeWork(file, asset.work);
+            fprintf(file, "}");
+        }
+        fprintf(file, "\n  ]\n}\n");
+        return fclose(file) == 0;
+    }
+
+    void StartupReport::printSummary(std::ostream& out) {
+        out << "Startup: ready after " << totalTime << " ms, work";
+        for (int kind = 0; kind < LOAD_WORK_COUNT; kind++) {
+            out << (kind > 0 ? ", " : " ") << WORK_NAMES[kind] << " " << totals[kind] << " ms";
+        }
+        out << std::endl;
+        for (size_t i = 0; i < phases.size(); i++) {
+            out << "  " << phases[i].name << ": " << phases[i].duration << " ms" << std::endl;
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef StartupReport_hpp
+#define StartupReport_hpp
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    enum LOAD_WORK {LOAD_IO, LOAD_PARSE, LOAD_DECODE, LOAD_UPLOAD, LOAD_COMPILE, LOAD_OTHER, LOAD_WORK_COUNT};
+
+    // Where the time to a ready scene went, built from the trace of the startup: every
+    // top level "startup" scope of the main thread is a phase, every file (model, texture,
+    // shader) an asset. The time of a scope less that of the scopes nested in it is counted
+    // as one kind of work by the scope's name: "Read file" is file I/O, "Parse OBJ" parsing,
+    // "Decode texture" image decoding, "Upload ..." and "Setup vertex arrays" GL uploads,
+    // "Compile shader" shader compilation; anything else, waiting included, is other.
+    // Work on the streaming and job threads belongs to its assets and to the totals, which
+    // therefore add up to more than the wall clock time when loading runs in parallel.
+    // Assets are told apart by the detail of their trace scopes, the path; a path longer
+    // than trace::DETAIL_LENGTH is reported by its end behind a hash of the whole path.
+    class StartupReport
+    {
+    public:
+        //from the events traced so far, once loading finished
+        void build();
+
+        bool writeJson(const std::string& path);
+        void printSummary(std::ostream& out);
+
+    private:
+        struct Phase {
+            std::string name;
+            double start;
+            double duration;
+            double work[LOAD_WORK_COUNT];
+        };
+
+        struct Asset {
+            std::string path;
+            const char* type;
+            //first scope began, last scope ended
+            double start;
+            double ready;
+            double work[LOAD_WORK_COUNT];
+        };
+
+        //all times in milliseconds since the trace started
+        std::vector<Phase> phases;
+        std::vector<Asset> assets;
+        double totals[LOAD_WORK_COUNT];
+        double totalTime;
+    };
+}
+
+#endif /* StartupReport_hpp */
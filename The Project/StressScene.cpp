@@ -0,0 +1,91 @@
+#include "StressScene.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace gps {
+
+    static bool insideKeepOut(const StressSceneParams& params, float x, float z) {
+        return std::fabs(x) < params.keepOut && std::fabs(z) < params.keepOut;
+    }
+
+    static glm::mat4 instanceMatrix(const glm::mat4& baseMatrix, float x, float z, float yaw) {
+        glm::mat4 localMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(x, 0.0f, z));
+        localMatrix = glm::rotate(localMatrix, yaw, glm::vec3(0.0f, 1.0f, 0.0f));
+        return localMatrix * baseMatrix;
+    }
+
+    //square rings of cells around the origin, ring r holding the cells with max(|i|, |j|) == r
+    static void generateGrid(const StressSceneParams& params, const glm::mat4* baseMatrices, size_t kindCount,
+        const std::function<void(size_t kind, const glm::mat4& localMatrix)>& place) {
+        size_t placed = 0;
+        for (int ring = 0; placed < params.count; ring++) {
+            //the perimeter as four sides of 2 * ring cells, the single center cell for ring 0
+            int sideLength = ring > 0 ? 2 * ring : 1;
+            int sides = ring > 0 ? 4 : 1;
+            for (int side = 0; side < sides && placed < params.count; side++) {
+                for (int step = 0; step < sideLength && placed < params.count; step++) {
+                    int i = 0;
+                    int j = 0;
+                    switch (side) {
+                    case 0: i = -ring + step; j = -ring; break;
+                    case 1: i = ring; j = -ring + step; break;
+                    case 2: i = ring - step; j = ring; break;
+                    default: i = -ring; j = ring - step; break;
+                    }
+
+                    float x = i * params.spacing;
+                    float z = j * params.spacing;
+                    if (insideKeepOut(params, x, z)) {
+                        continue;
+                    }
+                    size_t kind = placed % kindCount;
+                    place(kind, instanceMatrix(baseMatrices[kind], x, z, 0.0f));
+                    placed++;
+                }
+            }
+        }
+    }
+
+    static void generateRandom(const StressSceneParams& params, const glm::mat4* baseMatrices, size_t kindCount,
+        const std::function<void(size_t kind, const glm::mat4& localMatrix)>& place) {
+        //spacing squared of ground per instance, plus the keep out area
+        float keepOutSize = 2.0f * params.keepOut;
+        float size = std::sqrt((float)params.count * params.spacing * params.spacing + keepOutSize * keepOutSize);
+
+        //values are built from the engine output, which the standard fixes, rather than
+        //std distributions, which each library implements its own way
+        std::mt19937 random(params.seed);
+        auto unit = [&random]() {
+            return (float)(random() >> 8) * (1.0f / 16777216.0f);
+        };
+
+        size_t placed = 0;
+        while (placed < params.count) {
+            float x = (unit() - 0.5f) * size;
+            float z = (unit() - 0.5f) * size;
+            if (insideKeepOut(params, x, z)) {
+                continue;
+            }
+            size_t kind = std::min((size_t)(unit() * kindCount), kindCount - 1);
+            place(kind, instanceMatrix(baseMatrices[kind], x, z, unit() * glm::radians(360.0f)));
+            placed++;
+        }
+    }
+
+    void generateStressScene(const StressSceneParams& params, const glm::mat4* baseMatrices, size_t kindCount,
+        const std::function<void(size_t kind, const glm::mat4& localMatrix)>& place) {
+        if (kindCount == 0 || params.spacing <= 0.0f) {
+            return;
+        }
+        if (params.layout == STRESS_RANDOM) {
+            generateRandom(params, baseMatrices, kindCount, place);
+        }
+        else {
+            generateGrid(params, baseMatrices, kindCount, place);
+        }
+    }
+}
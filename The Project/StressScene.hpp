@@ -0,0 +1,32 @@
+#ifndef StressScene_hpp
+#define StressScene_hpp
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <functional>
+
+namespace gps {
+
+    enum STRESS_LAYOUT {STRESS_GRID, STRESS_RANDOM};
+
+    struct StressSceneParams {
+        size_t count;
+        STRESS_LAYOUT layout;
+        unsigned int seed;
+        //distance between grid cells, and the average one of the random layout
+        float spacing;
+        //half size of the square around the origin left free for the bundled scene
+        float keepOut;
+    };
+
+    // Places count instances on the ground plane for scaling tests, cycling through kinds.
+    // The grid is a square spiralling out of the keep out area, so every count gives a
+    // compact patch; the random layout scatters instances uniformly over a square of the
+    // same density with random yaw, the same for a given seed. Each instance matrix is
+    // translate(position) * rotate(yaw) * baseMatrices[kind], handed to place in order.
+    void generateStressScene(const StressSceneParams& params, const glm::mat4* baseMatrices, size_t kindCount,
+        const std::function<void(size_t kind, const glm::mat4& localMatrix)>& place);
+}
+
+#endif /* StressScene_hpp */
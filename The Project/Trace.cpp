@@ -0,0 +1,298 @@
+#include "Trace.hpp"
+#include "Json.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace gps {
+    namespace trace {
+
+        static const unsigned int MAX_DEPTH = 32;
+        static const size_t NO_EVENT = (size_t)-1;
+        static const unsigned int CHUNK_COUNT = EVENTS_PER_THREAD / EVENTS_PER_CHUNK;
+        //threads with an id past this keep no name
+        static const unsigned int MAX_NAMED_THREADS = 256;
+
+        typedef std::chrono::steady_clock Clock;
+
+        struct Event {
+            const char* name;
+            const char* category;
+            //microseconds since start
+            double start;
+            //negative until the scope ended, stored with release once it did
+            std::atomic<double> duration;
+            unsigned int thread;
+            char detail[DETAIL_LENGTH];
+        };
+
+        // Written by the thread owning it only; count is published with release after the
+        // chunk and the begin data, so that a reader sees complete events. A buffer outlives
+        // its thread: once the thread exited, the next thread to trace takes it over and
+        // records after the events already there.
+        struct ThreadBuffer {
+            std::atomic<Event*> chunks[CHUNK_COUNT];
+            std::atomic<size_t> count;
+            size_t dropped;
+            //events still open, NO_EVENT for the dropped ones
+            size_t open[MAX_DEPTH];
+            unsigned int depth;
+            std::atomic<bool> owned;
+            ThreadBuffer* next;
+        };
+
+        // The buffer and id of the current thread, gives the buffer back when the thread exits
+        struct ThreadState {
+            ThreadBuffer* buffer;
+            unsigned int id;
+
+            ~ThreadState() {
+                if (buffer != NULL) {
+                    buffer->depth = 0;
+                    buffer->owned.store(false, std::memory_order_release);
+                }
+            }
+        };
+
+        std::atomic<bool> enabled(false);
+        static Clock::time_point startTime;
+        static std::atomic<ThreadBuffer*> buffers(NULL);
+        static std::atomic<unsigned int> nextThreadId(1);
+        static thread_local ThreadState threadState = { NULL, 0 };
+
+        //by thread id, written once by the thread itself
+        static const char* threadNames[MAX_NAMED_THREADS];
+        static int threadNameIndices[MAX_NAMED_THREADS];
+
+        static double now() {
+            return std::chrono::duration<double, std::micro>(Clock::now() - startTime).count();
+        }
+
+        //the chunks come from malloc, outside the allocation counting of --alloc-check, which
+        //checks the frame loop and not the tracing of it
+        static Event* allocateChunk() {
+            Event* chunk = static_cast<Event*>(malloc(EVENTS_PER_CHUNK * sizeof(Event)));
+            if (chunk == NULL) {
+                return NULL;
+            }
+            for (unsigned int i = 0; i < EVENTS_PER_CHUNK; i++) {
+                new (&chunk[i]) Event();
+            }
+            return chunk;
+        }
+
+        static ThreadBuffer* currentBuffer() {
+            ThreadState& state = threadState;
+            if (state.buffer == NULL) {
+                state.id = nextThreadId++;
+
+                //a buffer left by a thread that exited, else a new one
+                ThreadBuffer* buffer = buffers.load();
+                while (buffer != NULL) {
+                    bool owned = false;
+                    if (!buffer->owned.load(std::memory_order_relaxed)
+                        && buffer->owned.compare_exchange_strong(owned, true, std::memory_order_acquire)) {
+                        break;
+                    }
+                    buffer = buffer->next;
+                }
+
+                if (buffer == NULL) {
+                    buffer = new ThreadBuffer;
+                    for (unsigned int i = 0; i < CHUNK_COUNT; i++) {
+                        buffer->chunks[i] = NULL;
+                    }
+                    buffer->count = 0;
+                    buffer->dropped = 0;
+                    buffer->depth = 0;
+                    buffer->owned = true;
+
+                    buffer->next = buffers.load();
+                    while (!buffers.compare_exchange_weak(buffer->next, buffer)) {
+                    }
+                }
+                state.buffer = buffer;
+            }
+            return state.buffer;
+        }
+
+        static Event& eventAt(ThreadBuffer* buffer, size_t index) {
+            return buffer->chunks[index / EVENTS_PER_CHUNK].load(std::memory_order_relaxed)[index % EVENTS_PER_CHUNK];
+        }
+
+        static void copyDetail(char* target, const char* detail) {
+            size_t length = strlen(detail);
+            if (length < DETAIL_LENGTH) {
+                memcpy(target, detail, length + 1);
+                return;
+            }
+            //32 bit FNV-1a of the whole detail
+            unsigned int hash = 2166136261u;
+            for (size_t i = 0; i < length; i++) {
+                hash = (hash ^ (unsigned char)detail[i]) * 16777619u;
+            }
+            int prefix = snprintf(target, DETAIL_LENGTH, "...%08x:", hash);
+            size_t tail = DETAIL_LENGTH - 1 - prefix;
+            memcpy(target + prefix, detail + length - tail, tail + 1);
+        }
+
+        void start() {
+            startTime = Clock::now();
+            enabled = true;
+        }
+
+        void stop() {
+            enabled = false;
+        }
+
+        void setThreadName(const char* name, int index) {
+            if (!isEnabled()) {
+                return;
+            }
+            currentBuffer();
+            unsigned int id = threadState.id;
+            if (id < MAX_NAMED_THREADS) {
+                threadNames[id] = name;
+                threadNameIndices[id] = index;
+            }
+        }
+
+        void begin(const char* name, const char* category, const char* detail) {
+            ThreadBuffer* buffer = currentBuffer();
+            size_t index = buffer->count.load(std::memory_order_relaxed);
+
+            //the next chunk when the last one is full
+            size_t chunk = index / EVENTS_PER_CHUNK;
+            if (index < EVENTS_PER_THREAD && buffer->chunks[chunk].load(std::memory_order_relaxed) == NULL) {
+                buffer->chunks[chunk].store(allocateChunk(), std::memory_order_relaxed);
+            }
+
+            if (index < EVENTS_PER_THREAD && buffer->chunks[chunk].load(std::memory_order_relaxed) != NULL) {
+                Event& event = eventAt(buffer, index);
+                event.name = name;
+                event.category = category;
+                event.thread = threadState.id;
+                event.duration.store(-1.0, std::memory_order_relaxed);
+                event.detail[0] = '\0';
+                if (detail != NULL) {
+                    copyDetail(event.detail, detail);
+                }
+                event.start = now();
+                buffer->count.store(index + 1, std::memory_order_release);
+            }
+            else {
+                buffer->dropped++;
+                index = NO_EVENT;
+            }
+
+            if (buffer->depth < MAX_DEPTH) {
+                buffer->open[buffer->depth] = index;
+            }
+            buffer->depth++;
+        }
+
+        void end() {
+            ThreadBuffer* buffer = currentBuffer();
+            if (buffer->depth == 0) {
+                return;
+            }
+            buffer->depth--;
+            if (buffer->depth < MAX_DEPTH && buffer->open[buffer->depth] != NO_EVENT) {
+                Event& event = eventAt(buffer, buffer->open[buffer->depth]);
+                event.duration.store(now() - event.start, std::memory_order_release);
+            }
+        }
+
+        bool write(const std::string& path) {
+            FILE* file = fopen(path.c_str(), "w");
+            if (file == NULL) {
+                return false;
+            }
+
+            unsigned long long written = 0;
+            unsigned long long dropped = 0;
+            bool first = true;
+            fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+            unsigned int threadCount = std::min(nextThreadId.load(), MAX_NAMED_THREADS);
+            for (unsigned int id = 1; id < threadCount; id++) {
+                if (threadNames[id] == NULL) {
+                    continue;
+                }
+                char name[64];
+                if (threadNameIndices[id] > 0) {
+                    snprintf(name, sizeof(name), "%s %d", threadNames[id], threadNameIndices[id]);
+                }
+                else {
+                    snprintf(name, sizeof(name), "%s", threadNames[id]);
+                }
+                fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                    first ? "" : ",", id);
+                json::writeString(file, name);
+                fprintf(file, "}}");
+                first = false;
+            }
+
+            for (ThreadBuffer* buffer = buffers.load(); buffer != NULL; buffer = buffer->next) {
+                size_t count = buffer->count.load(std::memory_order_acquire);
+                for (size_t i = 0; i < count; i++) {
+                    const Event& event = eventAt(buffer, i);
+                    double duration = event.duration.load(std::memory_order_acquire);
+                    //scopes still open, e.g. a thread that never stopped
+                    if (duration < 0.0) {
+                        continue;
+                    }
+                    fprintf(file, "%s\n{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"name\":",
+                        first ? "" : ",", event.thread, event.start, duration);
+                    json::writeString(file, event.name);
+                    fprintf(file, ",\"cat\":");
+                    json::writeString(file, event.category);
+                    if (event.detail[0] != '\0') {
+                        fprintf(file, ",\"args\":{\"detail\":");
+                        json::writeString(file, event.detail);
+                        fprintf(file, "}");
+                    }
+                    fprintf(file, "}");
+                    first = false;
+                    written++;
+                }
+                dropped += buffer->dropped;
+            }
+            fprintf(file, "\n]}\n");
+
+            bool ok = fclose(file) == 0;
+            std::cout << "Trace: " << written << " events written to " << path << ", " << dropped << " dropped" << std::endl;
+            return ok;
+        }
+    
+        void collect(std::vector<Record>& records) {
+            size_t first = records.size();
+            for (ThreadBuffer* buffer = buffers.load(); buffer != NULL; buffer = buffer->next) {
+                size_t count = buffer->count.load(std::memory_order_acquire);
+                for (size_t i = 0; i < count; i++) {
+                    const Event& event = eventAt(buffer, i);
+                    double duration = event.duration.load(std::memory_order_acquire);
+                    if (duration < 0.0) {
+                        continue;
+                    }
+                    Record record;
+                    record.name = event.name;
+                    record.category = event.category;
+                    record.detail = event.detail;
+                    record.thread = event.thread;
+                    record.start = event.start;
+                    record.duration = duration;
+                    records.push_back(record);
+                }
+            }
+            //a thread's events are in the order they began, but buffers are linked newest first
+            //and a recycled buffer holds several threads
+            std::stable_sort(records.begin() + first, records.end(), [](const Record& a, const Record& b) {
+                return a.thread < b.thread;
+            });
+        }
+    }
+}
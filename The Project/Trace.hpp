@@ -0,0 +1,80 @@
+#ifndef Trace_hpp
+#define Trace_hpp
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    // Timeline of the run in the Chrome trace event format (chrome://tracing, ui.perfetto.dev):
+    // one complete event per traced scope with its thread, start and duration.
+    // Every thread records into its own buffer, taken at its first event and linked into a
+    // lock-free list; recording takes no lock. A buffer grows in chunks of EVENTS_PER_CHUNK
+    // up to EVENTS_PER_THREAD, past that events are dropped and counted. When a thread
+    // exits its buffer, events kept, goes to the next thread that starts tracing, so short
+    // lived threads do not add up. When tracing is off a scope costs one relaxed load.
+    namespace trace {
+
+        static const unsigned int EVENTS_PER_THREAD = 16384;
+        static const unsigned int EVENTS_PER_CHUNK = 512;
+        //a longer detail keeps its end, the file name of a path, behind a hash of the whole
+        //("...1f2e3d4c:<end>"), so that details cut short stay apart
+        static const unsigned int DETAIL_LENGTH = 128;
+
+        // A completed event, as handed out by collect(); times in microseconds since start
+        struct Record {
+            const char* name;
+            const char* category;
+            std::string detail;
+            unsigned int thread;
+            double start;
+            double duration;
+        };
+
+        extern std::atomic<bool> enabled;
+
+        inline bool isEnabled() {
+            return enabled.load(std::memory_order_relaxed);
+        }
+
+        //starts the clock of the trace, events before are not recorded
+        void start();
+        //no new events after this; scopes already open still end, recorded events are kept
+        void stop();
+
+        //names the calling thread in the trace, index > 0 is appended ("Worker 3")
+        void setThreadName(const char* name, int index = 0);
+
+        //name and category must outlive the trace (string literals), detail is copied
+        void begin(const char* name, const char* category, const char* detail = NULL);
+        void end();
+
+        //the events recorded so far, once the traced threads are idle or stopped
+        bool write(const std::string& path);
+        //appends the completed events so far, by thread id and within a thread in the order they began
+        void collect(std::vector<Record>& records);
+    }
+
+    // Traces the lifetime of the scope, when tracing is on
+    class TraceScope
+    {
+    public:
+        TraceScope(const char* name, const char* category, const char* detail = NULL) : active(trace::isEnabled()) {
+            if (active) {
+                trace::begin(name, category, detail);
+            }
+        }
+
+        ~TraceScope() {
+            if (active) {
+                trace::end();
+            }
+        }
+
+    private:
+        bool active;
+    };
+}
+
+#endif /* Trace_hpp */
@@ -0,0 +1,170 @@
+#include "TransformKernel.hpp"
+#include "Simd.hpp"
+
+namespace gps {
+
+    //inverse transpose of the 3x3 with columns a, b, c is (b x c, c x a, a x b) / det
+    static void normalMatrixScalar(const glm::mat4& modelView, glm::mat3& normalMatrix) {
+        glm::vec3 a(modelView[0]);
+        glm::vec3 b(modelView[1]);
+        glm::vec3 c(modelView[2]);
+
+        glm::vec3 bc = glm::cross(b, c);
+        float inverseDeterminant = 1.0f / glm::dot(a, bc);
+
+        normalMatrix[0] = bc * inverseDeterminant;
+        normalMatrix[1] = glm::cross(c, a) * inverseDeterminant;
+        normalMatrix[2] = glm::cross(a, b) * inverseDeterminant;
+    }
+
+    void computeViewTransformsScalar(const glm::mat4& view, const glm::mat4* models, size_t count,
+        glm::mat4* modelViews, glm::mat3* normalMatrices) {
+        for (size_t i = 0; i < count; i++) {
+            modelViews[i] = view * models[i];
+            normalMatrixScalar(modelViews[i], normalMatrices[i]);
+        }
+    }
+
+#if defined(GPS_SIMD_SSE)
+
+    #define GPS_YZX _MM_SHUFFLE(3, 0, 2, 1)
+    #define GPS_ZXY _MM_SHUFFLE(3, 1, 0, 2)
+
+    static inline __m128 cross4(__m128 a, __m128 b) {
+        return _mm_sub_ps(
+            _mm_mul_ps(_mm_shuffle_ps(a, a, GPS_YZX), _mm_shuffle_ps(b, b, GPS_ZXY)),
+            _mm_mul_ps(_mm_shuffle_ps(a, a, GPS_ZXY), _mm_shuffle_ps(b, b, GPS_YZX)));
+    }
+
+    //view * column, the view columns already loaded
+    static inline __m128 transformColumn4(const __m128 viewColumns[4], __m128 column) {
+        __m128 result = _mm_mul_ps(viewColumns[0], _mm_shuffle_ps(column, column, _MM_SHUFFLE(0, 0, 0, 0)));
+        result = _mm_add_ps(result, _mm_mul_ps(viewColumns[1], _mm_shuffle_ps(column, column, _MM_SHUFFLE(1, 1, 1, 1))));
+        result = _mm_add_ps(result, _mm_mul_ps(viewColumns[2], _mm_shuffle_ps(column, column, _MM_SHUFFLE(2, 2, 2, 2))));
+        result = _mm_add_ps(result, _mm_mul_ps(viewColumns[3], _mm_shuffle_ps(column, column, _MM_SHUFFLE(3, 3, 3, 3))));
+        return result;
+    }
+
+    //three columns stored as 9 tightly packed floats (a glm::mat3); each store spills one
+    //float into the next column, which the next store overwrites
+    static inline void storeMat3(__m128 x, __m128 y, __m128 z, float* out) {
+        _mm_storeu_ps(out, x);
+        _mm_storeu_ps(out + 3, y);
+        _mm_storel_pi((__m64*)(out + 6), z);
+        _mm_store_ss(out + 8, _mm_shuffle_ps(z, z, _MM_SHUFFLE(2, 2, 2, 2)));
+    }
+
+    //normal matrix from the first three model-view columns
+    static inline void storeNormalMatrix4(__m128 a, __m128 b, __m128 c, float* out) {
+        __m128 bc = cross4(b, c);
+        __m128 ca = cross4(c, a);
+        __m128 ab = cross4(a, b);
+
+        //x + y + z in each of the first three lanes
+        __m128 products = _mm_mul_ps(a, bc);
+        __m128 determinant = _mm_add_ps(products, _mm_add_ps(
+            _mm_shuffle_ps(products, products, GPS_YZX),
+            _mm_shuffle_ps(products, products, GPS_ZXY)));
+        __m128 inverseDeterminant = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+
+        bc = _mm_mul_ps(bc, inverseDeterminant);
+        ca = _mm_mul_ps(ca, inverseDeterminant);
+        ab = _mm_mul_ps(ab, inverseDeterminant);
+
+        storeMat3(bc, ca, ab, out);
+    }
+
+    static void computeOne4(const __m128 viewColumns[4], const glm::mat4& model, glm::mat4& modelView, glm::mat3& normalMatrix) {
+        const float* in = &model[0][0];
+        float* out = &modelView[0][0];
+
+        __m128 columns[4];
+        for (int j = 0; j < 4; j++) {
+            columns[j] = transformColumn4(viewColumns, _mm_loadu_ps(in + 4 * j));
+            _mm_storeu_ps(out + 4 * j, columns[j]);
+        }
+
+        storeNormalMatrix4(columns[0], columns[1], columns[2], &normalMatrix[0][0]);
+    }
+
+#endif
+
+#if defined(GPS_SIMD_AVX2)
+
+    //the AVX2 path runs two matrices side by side, one per 128 bit lane, so every
+    //shuffle of the SSE path works unchanged with the in-lane _mm256_permute_ps
+    static inline __m256 cross8(__m256 a, __m256 b) {
+        return _mm256_sub_ps(
+            _mm256_mul_ps(_mm256_permute_ps(a, GPS_YZX), _mm256_permute_ps(b, GPS_ZXY)),
+            _mm256_mul_ps(_mm256_permute_ps(a, GPS_ZXY), _mm256_permute_ps(b, GPS_YZX)));
+    }
+
+    static inline __m256 transformColumn8(const __m256 viewColumns[4], __m256 column) {
+        __m256 result = _mm256_mul_ps(viewColumns[0], _mm256_permute_ps(column, _MM_SHUFFLE(0, 0, 0, 0)));
+        result = _mm256_add_ps(result, _mm256_mul_ps(viewColumns[1], _mm256_permute_ps(column, _MM_SHUFFLE(1, 1, 1, 1))));
+        result = _mm256_add_ps(result, _mm256_mul_ps(viewColumns[2], _mm256_permute_ps(column, _MM_SHUFFLE(2, 2, 2, 2))));
+        result = _mm256_add_ps(result, _mm256_mul_ps(viewColumns[3], _mm256_permute_ps(column, _MM_SHUFFLE(3, 3, 3, 3))));
+        return result;
+    }
+
+    static void computeTwo8(const __m256 viewColumns[4], const glm::mat4* models, glm::mat4* modelViews, glm::mat3* normalMatrices) {
+        const float* in0 = &models[0][0][0];
+        const float* in1 = &models[1][0][0];
+        float* out0 = &modelViews[0][0][0];
+        float* out1 = &modelViews[1][0][0];
+
+        __m256 columns[4];
+        for (int j = 0; j < 4; j++) {
+            __m256 column = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(in0 + 4 * j)), _mm_loadu_ps(in1 + 4 * j), 1);
+            columns[j] = transformColumn8(viewColumns, column);
+            _mm_storeu_ps(out0 + 4 * j, _mm256_castps256_ps128(columns[j]));
+            _mm_storeu_ps(out1 + 4 * j, _mm256_extractf128_ps(columns[j], 1));
+        }
+
+        __m256 bc = cross8(columns[1], columns[2]);
+        __m256 ca = cross8(columns[2], columns[0]);
+        __m256 ab = cross8(columns[0], columns[1]);
+
+        __m256 products = _mm256_mul_ps(columns[0], bc);
+        __m256 determinant = _mm256_add_ps(products, _mm256_add_ps(
+            _mm256_permute_ps(products, GPS_YZX),
+            _mm256_permute_ps(products, GPS_ZXY)));
+        __m256 inverseDeterminant = _mm256_div_ps(_mm256_set1_ps(1.0f), determinant);
+
+        bc = _mm256_mul_ps(bc, inverseDeterminant);
+        ca = _mm256_mul_ps(ca, inverseDeterminant);
+        ab = _mm256_mul_ps(ab, inverseDeterminant);
+
+        storeMat3(_mm256_castps256_ps128(bc), _mm256_castps256_ps128(ca), _mm256_castps256_ps128(ab), &normalMatrices[0][0][0]);
+        storeMat3(_mm256_extractf128_ps(bc, 1), _mm256_extractf128_ps(ca, 1), _mm256_extractf128_ps(ab, 1), &normalMatrices[1][0][0]);
+    }
+
+#endif
+
+    void computeViewTransforms(const glm::mat4& view, const glm::mat4* models, size_t count,
+        glm::mat4* modelViews, glm::mat3* normalMatrices) {
+#if defined(GPS_SIMD_SSE)
+        size_t i = 0;
+
+#if defined(GPS_SIMD_AVX2)
+        __m256 viewColumns8[4];
+        for (int k = 0; k < 4; k++) {
+            viewColumns8[k] = _mm256_broadcast_ps((const __m128*)&view[k][0]);
+        }
+        for (; i + 2 <= count; i += 2) {
+            computeTwo8(viewColumns8, models + i, modelViews + i, normalMatrices + i);
+        }
+#endif
+
+        __m128 viewColumns4[4];
+        for (int k = 0; k < 4; k++) {
+            viewColumns4[k] = _mm_loadu_ps(&view[k][0]);
+        }
+        for (; i < count; i++) {
+            computeOne4(viewColumns4, models[i], modelViews[i], normalMatrices[i]);
+        }
+#else
+        computeViewTransformsScalar(view, models, count, modelViews, normalMatrices);
+#endif
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef TransformKernel_hpp
+#define TransformKernel_hpp
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+namespace gps {
+
+    // Batched per frame transforms: for every model matrix, modelView = view * model and
+    // normalMatrix = inverse transpose of the upper 3x3 of modelView, in one pass over
+    // contiguous arrays. Model matrices must be affine.
+    // Uses AVX2 (two matrices per iteration) or SSE when available, see Simd.hpp.
+    void computeViewTransforms(const glm::mat4& view, const glm::mat4* models, size_t count,
+        glm::mat4* modelViews, glm::mat3* normalMatrices);
+
+    // Same results without SIMD, also used as the reference by the benchmark
+    void computeViewTransformsScalar(const glm::mat4& view, const glm::mat4* models, size_t count,
+        glm::mat4* modelViews, glm::mat3* normalMatrices);
+}
+
+#endif /* TransformKernel_hpp */
@@ -0,0 +1,74 @@
+#include "TransformStore.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace gps {
+
+    TransformId TransformStore::create(const glm::mat4& localMatrix, TransformId parentId) {
+        TransformId id = (TransformId)local.size();
+
+        local.push_back(localMatrix);
+        world.push_back(localMatrix);
+        parent.push_back(parentId);
+        dirty.push_back(1);
+
+        firstDirty = std::min(firstDirty, (size_t)id);
+        return id;
+    }
+
+    void TransformStore::setLocal(TransformId id, const glm::mat4& localMatrix) {
+        local[id] = localMatrix;
+        dirty[id] = 1;
+        firstDirty = std::min(firstDirty, (size_t)id);
+    }
+
+    const glm::mat4& TransformStore::getLocal(TransformId id) {
+        return local[id];
+    }
+
+    const glm::mat4& TransformStore::getWorld(TransformId id) {
+        return world[id];
+    }
+
+    TransformId TransformStore::getParent(TransformId id) {
+        return parent[id];
+    }
+
+    size_t TransformStore::update() {
+        size_t count = local.size();
+        size_t updated = 0;
+
+        //parents always come before their children, so one forward pass is enough
+        for (size_t i = firstDirty; i < count; i++) {
+            TransformId p = parent[i];
+            if (p != NO_PARENT && dirty[p]) {
+                dirty[i] = 1;
+            }
+
+            if (dirty[i]) {
+                world[i] = (p == NO_PARENT) ? local[i] : world[p] * local[i];
+                updated++;
+            }
+        }
+
+        if (firstDirty < count) {
+            memset(&dirty[firstDirty], 0, count - firstDirty);
+        }
+        firstDirty = count;
+
+        return updated;
+    }
+
+    size_t TransformStore::size() {
+        return local.size();
+    }
+
+    void TransformStore::clear() {
+        local.clear();
+        world.clear();
+        parent.clear();
+        dirty.clear();
+        firstDirty = 0;
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef TransformStore_hpp
+#define TransformStore_hpp
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace gps {
+
+    typedef unsigned int TransformId;
+
+    const TransformId NO_PARENT = 0xffffffffu;
+
+    // Structure of arrays holding local and world matrices with parent links.
+    // Only transforms marked dirty (and their descendants) are recomputed by update(),
+    // so static objects cost nothing after the first frame.
+    // A parent must be created before its children; create animated transforms after
+    // the static ones so that the update only walks the tail of the arrays.
+    class TransformStore
+    {
+    public:
+        TransformId create(const glm::mat4& localMatrix, TransformId parent = NO_PARENT);
+
+        //replaces the local matrix and marks the transform dirty
+        void setLocal(TransformId id, const glm::mat4& localMatrix);
+
+        const glm::mat4& getLocal(TransformId id);
+        const glm::mat4& getWorld(TransformId id);
+        TransformId getParent(TransformId id);
+
+        //recomputes the world matrices of dirty transforms and their children, returns how many were recomputed
+        size_t update();
+
+        size_t size();
+        void clear();
+
+    private:
+        std::vector<glm::mat4> local;
+        std::vector<glm::mat4> world;
+        std::vector<TransformId> parent;
+        std::vector<unsigned char> dirty;
+
+        //lowest dirty index, size() when nothing is dirty
+        size_t firstDirty = 0;
+    };
+}
+
+#endif /* TransformStore_hpp */
@@ -0,0 +1,57 @@
+#ifndef TripleBuffer_hpp
+#define TripleBuffer_hpp
+
+#include <atomic>
+
+namespace gps {
+
+    // Lock-free single producer, single consumer triple buffer. The writer fills its back
+    // slot and publishes it by swapping it with the middle slot; the reader swaps the middle
+    // slot with its front slot when something new was published. Neither side ever waits,
+    // the reader always sees the latest complete value and slots are reused, not copied.
+    template <typename T>
+    class TripleBuffer
+    {
+    public:
+        TripleBuffer() : middle(1), back(0), front(2) {
+        }
+
+        //slot the writer fills, stays the same until publish()
+        T& writeBuffer() {
+            return slots[back];
+        }
+
+        //hands the write slot to the reader, the writer continues with the previous middle slot
+        void publish() {
+            back = middle.exchange(back | NEW_DATA, std::memory_order_acq_rel) & SLOT_MASK;
+        }
+
+        //takes the latest published slot if there is one, returns whether it is new
+        bool update() {
+            if ((middle.load(std::memory_order_relaxed) & NEW_DATA) == 0) {
+                return false;
+            }
+            front = middle.exchange(front, std::memory_order_acq_rel) & SLOT_MASK;
+            return true;
+        }
+
+        //slot the reader uses, stays the same until update()
+        const T& readBuffer() {
+            return slots[front];
+        }
+
+    private:
+        static const unsigned int SLOT_MASK = 3;
+        static const unsigned int NEW_DATA = 4;
+
+        T slots[3];
+        //middle slot index, plus NEW_DATA while the reader has not taken it
+        std::atomic<unsigned int> middle;
+        //owned by the writer
+        unsigned int back;
+        //owned by the reader
+        unsigned int front;
+    };
+}
+
+#endif /* TripleBuffer_hpp */
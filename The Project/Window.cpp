@@ -1,7 +1,48 @@
 #include "Window.h"
+#include "MemoryTracker.hpp"
+
+#include <chrono>
+
+// Headless rendering goes through EGL (libEGL of Mesa or a GPU driver). The Visual Studio
+// project does not build it; the CMake build defines GPS_HEADLESS_EGL and links libEGL
+// (GPS_HEADLESS, on by default), without it CreateHeadless throws.
+#if defined(GPS_HEADLESS_EGL)
+    #include <EGL/egl.h>
+    #include <EGL/eglext.h>
+#endif
 
 namespace gps {
 
+    SharedContext::SharedContext() : window(NULL), display(NULL), context(NULL) {
+    }
+
+    void SharedContext::makeCurrent() {
+#if defined(GPS_HEADLESS_EGL)
+        if (context != NULL) {
+            //the bound API is per thread and defaults to OpenGL ES
+            eglBindAPI(EGL_OPENGL_API);
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+            return;
+        }
+#endif
+        glfwMakeContextCurrent(window);
+    }
+
+    void SharedContext::release() {
+#if defined(GPS_HEADLESS_EGL)
+        if (context != NULL) {
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            return;
+        }
+#endif
+        glfwMakeContextCurrent(NULL);
+    }
+
+    Window::Window() : window(NULL), closeRequested(false), eglDisplay(NULL), eglContext(NULL), framebuffer(0), colorBuffer(0), depthBuffer(0) {
+        dimensions.width = 0;
+        dimensions.height = 0;
+    }
+
     void Window::Create(int width, int height, const char *title) {
         if (!glfwInit()) {
             throw std::runtime_error("Could not start GLFW3!");
@@ -12,6 +53,10 @@ namespace gps {
         glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
         glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
         glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifndef NDEBUG
+        //drivers report more, performance warnings included, to debug contexts
+        glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
+#endif
 
         // for sRGB framebuffer
         glfwWindowHint(GLFW_SRGB_CAPABLE, GLFW_TRUE);
@@ -28,21 +73,238 @@ namespace gps {
 
         glfwSwapInterval(1);
 
+        initGlew();
+
+        //for RETINA display
+        glfwGetFramebufferSize(window, &this->dimensions.width, &this->dimensions.height);
+    }
+
+#if defined(GPS_HEADLESS_EGL)
+    // The surfaceless platform needs no display server at all; without it (drivers lacking
+    // EGL_MESA_platform_surfaceless) the default display is tried
+    static EGLDisplay openHeadlessDisplay() {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        EGLint major, minor;
+
+        if (getPlatformDisplay != NULL) {
+            EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+            if (display != EGL_NO_DISPLAY && eglInitialize(display, &major, &minor)) {
+                return display;
+            }
+        }
+
+        EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (display != EGL_NO_DISPLAY && eglInitialize(display, &major, &minor)) {
+            return display;
+        }
+        return EGL_NO_DISPLAY;
+    }
+
+    // Same version and profile as the window context
+    static EGLContext createHeadlessContext(EGLDisplay display, EGLContext shareContext) {
+        //the default surface type asks for window surfaces, which headless displays do not have
+        const EGLint configAttributes[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_NONE
+        };
+        EGLConfig config;
+        EGLint configCount = 0;
+        if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+            return EGL_NO_CONTEXT;
+        }
+
+        const EGLint contextAttributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 4,
+            EGL_CONTEXT_MINOR_VERSION, 1,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_CONTEXT_OPENGL_FORWARD_COMPATIBLE, EGL_TRUE,
+#ifndef NDEBUG
+            EGL_CONTEXT_OPENGL_DEBUG, EGL_TRUE,
+#endif
+            EGL_NONE
+        };
+        return eglCreateContext(display, config, shareContext, contextAttributes);
+    }
+#endif
+
+    void Window::CreateHeadless(int width, int height) {
+#if defined(GPS_HEADLESS_EGL)
+        EGLDisplay display = openHeadlessDisplay();
+        if (display == EGL_NO_DISPLAY) {
+            throw std::runtime_error("Could not open an EGL display!");
+        }
+        if (!eglBindAPI(EGL_OPENGL_API)) {
+            throw std::runtime_error("EGL has no desktop OpenGL!");
+        }
+
+        EGLContext context = createHeadlessContext(display, EGL_NO_CONTEXT);
+        if (context == EGL_NO_CONTEXT) {
+            throw std::runtime_error("Could not create an OpenGL 4.1 core EGL context!");
+        }
+        //without a surface, which needs EGL_KHR_surfaceless_context (Mesa and current GPU drivers)
+        if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+            throw std::runtime_error("Could not make the EGL context current without a surface!");
+        }
+
+        this->eglDisplay = display;
+        this->eglContext = context;
+        this->dimensions.width = width;
+        this->dimensions.height = height;
+
+        initGlew();
+        createFramebuffer();
+#else
+        throw std::runtime_error("Headless rendering needs EGL, not available in this build!");
+#endif
+    }
+
+    void Window::initGlew() {
         // start GLEW extension handler
         glewExperimental = GL_TRUE;
-        glewInit();
+        GLenum status = glewInit();
+        //GLEW built for GLX loads the GL functions but finds no GLX display under EGL
+        if (status != GLEW_OK && !(isHeadless() && status == GLEW_ERROR_NO_GLX_DISPLAY)) {
+            throw std::runtime_error((const char*)glewGetErrorString(status));
+        }
 
         // get version info
         const GLubyte* renderer = glGetString(GL_RENDERER); // get renderer string
         const GLubyte* version = glGetString(GL_VERSION); // version as a string
         std::cout << "Renderer: " << renderer << std::endl;
         std::cout << "OpenGL version: " << version << std::endl;
+    }
 
-        //for RETINA display
-        glfwGetFramebufferSize(window, &this->dimensions.width, &this->dimensions.height);
+    // sRGB color like the window's framebuffer, single sampled so that it can be read back directly
+    void Window::createFramebuffer() {
+        glGenRenderbuffers(1, &colorBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_SRGB8_ALPHA8, dimensions.width, dimensions.height);
+        MemoryTracker::shared().trackRenderbuffer(colorBuffer, GL_SRGB8_ALPHA8, dimensions.width, dimensions.height, "Window", "color");
+
+        glGenRenderbuffers(1, &depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, dimensions.width, dimensions.height);
+        MemoryTracker::shared().trackRenderbuffer(depthBuffer, GL_DEPTH24_STENCIL8, dimensions.width, dimensions.height, "Window", "depth");
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            throw std::runtime_error("Offscreen framebuffer is incomplete!");
+        }
+        //stays bound, it replaces the default framebuffer
+    }
+
+    SharedContext Window::CreateSharedContext() {
+        SharedContext shared;
+
+#if defined(GPS_HEADLESS_EGL)
+        if (isHeadless()) {
+            shared.display = eglDisplay;
+            shared.context = createHeadlessContext(eglDisplay, eglContext);
+            if (shared.context == EGL_NO_CONTEXT) {
+                throw std::runtime_error("Could not create shared EGL context!");
+            }
+            return shared;
+        }
+#endif
+
+        //same context hints as Create() are still set
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        shared.window = glfwCreateWindow(1, 1, "", NULL, this->window);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+        if (!shared.window) {
+            throw std::runtime_error("Could not create shared GLFW3 context!");
+        }
+        return shared;
+    }
+
+    void Window::DestroySharedContext(SharedContext &context) {
+#if defined(GPS_HEADLESS_EGL)
+        if (context.context != NULL) {
+            eglDestroyContext(context.display, context.context);
+        }
+#endif
+        if (context.window != NULL) {
+            glfwDestroyWindow(context.window);
+        }
+        context = SharedContext();
+    }
+
+    void Window::MakeCurrent() {
+#if defined(GPS_HEADLESS_EGL)
+        if (isHeadless()) {
+            //for a thread other than the one that created the context
+            eglBindAPI(EGL_OPENGL_API);
+            eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext);
+            return;
+        }
+#endif
+        glfwMakeContextCurrent(window);
+    }
+
+    void Window::ReleaseCurrent() {
+#if defined(GPS_HEADLESS_EGL)
+        if (isHeadless()) {
+            eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            return;
+        }
+#endif
+        glfwMakeContextCurrent(NULL);
+    }
+
+    void Window::SwapBuffers() {
+        if (isHeadless()) {
+            glFlush();
+            return;
+        }
+        glfwSwapBuffers(window);
+    }
+
+    void Window::PollEvents() {
+        if (!isHeadless()) {
+            glfwPollEvents();
+        }
+    }
+
+    bool Window::ShouldClose() {
+        return closeRequested || (!isHeadless() && glfwWindowShouldClose(window));
+    }
+
+    void Window::Close() {
+        closeRequested = true;
+        if (!isHeadless()) {
+            glfwSetWindowShouldClose(window, GL_TRUE);
+        }
+    }
+
+    bool Window::isHeadless() {
+        return eglContext != NULL;
+    }
+
+    GLuint Window::getFramebuffer() {
+        return framebuffer;
     }
 
     void Window::Delete() {
+#if defined(GPS_HEADLESS_EGL)
+        if (isHeadless()) {
+            MemoryTracker::shared().release(MEMORY_RENDERBUFFER, colorBuffer);
+            MemoryTracker::shared().release(MEMORY_RENDERBUFFER, depthBuffer);
+            glDeleteFramebuffers(1, &framebuffer);
+            glDeleteRenderbuffers(1, &colorBuffer);
+            glDeleteRenderbuffers(1, &depthBuffer);
+            eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            eglDestroyContext(eglDisplay, eglContext);
+            eglTerminate(eglDisplay);
+            eglContext = NULL;
+            return;
+        }
+#endif
         if (window)
             glfwDestroyWindow(window);
         //close GL context and any other GLFW resources
@@ -60,4 +322,10 @@ namespace gps {
     void Window::setWindowDimensions(WindowDimensions dimensions) {
         this->dimensions = dimensions;
     }
-}
\ No newline at end of file
+
+    double Window::getTime() {
+        typedef std::chrono::steady_clock Clock;
+        static const Clock::time_point start = Clock::now();
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+}
@@ -13,19 +13,83 @@ struct WindowDimensions {
 
 namespace gps {
 
+    // A context sharing objects with a window's context, for work on another thread.
+    // Created and destroyed by the window on the main thread, current on one thread at a time.
+    class SharedContext {
+
+    public:
+        SharedContext();
+
+        void makeCurrent();
+        //leaves the calling thread without a current context
+        void release();
+
+    private:
+        friend class Window;
+
+        //windowed: a hidden 1x1 window
+        GLFWwindow *window;
+        //headless: the EGLDisplay and EGLContext
+        void *display;
+        void *context;
+    };
+
     class Window {
 
     public:
+        Window();
+
         void Create(int width=800, int height=600, const char *title="OpenGL Project");
+
+        // No window and no display: a surfaceless EGL context (Mesa llvmpipe is enough)
+        // drawing into an offscreen framebuffer that stands in for the default one.
+        // Throws when the build has no EGL (GPS_HEADLESS_EGL, see Window.cpp).
+        void CreateHeadless(int width, int height);
+
         void Delete();
 
+        // Context sharing objects with this one, for uploads from another thread;
+        // must be created and destroyed on the main thread
+        SharedContext CreateSharedContext();
+        void DestroySharedContext(SharedContext &context);
+
+        // Moves the window's own context between threads
+        void MakeCurrent();
+        void ReleaseCurrent();
+
+        // Shows the frame; headless only flushes the offscreen framebuffer
+        void SwapBuffers();
+        // Handles pending window events, nothing to do when headless
+        void PollEvents();
+        bool ShouldClose();
+        // Asks the frame loop to end, headless or not
+        void Close();
+
+        bool isHeadless();
+        // Framebuffer the scene ends up in: 0 for a window, the offscreen one when headless
+        GLuint getFramebuffer();
+
         GLFWwindow* getWindow();
         WindowDimensions getWindowDimensions();
         void setWindowDimensions(WindowDimensions dimensions);
 
+        // Seconds on a steady clock, the same clock in windowed and headless mode
+        static double getTime();
+
     private:
         WindowDimensions dimensions;
         GLFWwindow *window;
+        bool closeRequested;
+
+        //headless: EGL objects and the framebuffer standing in for the window
+        void *eglDisplay;
+        void *eglContext;
+        GLuint framebuffer;
+        GLuint colorBuffer;
+        GLuint depthBuffer;
+
+        void initGlew();
+        void createFramebuffer();
     };
 }
 
@@ -7,33 +7,61 @@
 #include <glm/gtc/matrix_inverse.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#ifdef _WIN32
 #include <Windows.h> 
 #pragma comment(lib, "Winmm.lib")
+#endif
 
 #include "Window.h"
 #include "Shader.hpp"
 #include "Camera.hpp"
 #include "Model3D.hpp"
 #include "SkyBox.hpp"
-
+#include "TransformStore.hpp"
+#include "FramePacket.hpp"
+#include "TripleBuffer.hpp"
+#include "InputQueue.hpp"
+#include "InputRecording.hpp"
+#include "TransformKernel.hpp"
+#include "JobSystem.hpp"
+#include "OcclusionCuller.hpp"
+#include "StressScene.hpp"
+#include "AssetStreamer.hpp"
+#include "FrameCapture.hpp"
+#include "GoldenImages.hpp"
+#include "FrameProfiler.hpp"
+#include "GLStats.hpp"
+#include "GLDebug.hpp"
+#include "MemoryTracker.hpp"
+#include "ProgramBinaryCache.hpp"
+#include "StartupReport.hpp"
+#include "Trace.hpp"
+#include "Benchmark.hpp"
+#include "BenchmarkSuite.hpp"
+#include "AllocationCounter.hpp"
+#include "Arena.hpp"
+
+#include <atomic>
 #include <iostream>
+#include <string>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <chrono>
 
 // window
 gps::Window myWindow;
 
 // matrices
-glm::mat4 model;
 glm::mat4 view;
 glm::mat4 projection;
 glm::mat4 lightRotation;
-glm::mat3 normalMatrix;
-glm::mat3 lightDirMatrix;
 typedef glm::mat4(*modelMatrix)();
 
 // light parameters
 glm::vec3 lightDir;
 glm::vec3 lightColor;
-glm::vec4 pointLightSource;
 
 int pointLightSourceLoc;
 
@@ -105,16 +133,50 @@ GLuint depthMapTexture;
 //depthmap related
 const GLfloat near_plane = 0.1f, far_plane = 100.0f;
 
-//floor placement
+//floor, wall and fence placement
 float floorOffset = 20.0f;
-float fLastX = 1.5f;
-float fLastY = 0.5f;
-float fLastZ = 0.5f;
-
 float wallOffset = 4.0f;
-float wLastX = 51.5f;
-float wLastY = 2.5f;
-float wLastZ = 0.0f;
+float fenceOffset = 13.5f;
+
+//scene
+struct SceneObject {
+    gps::Model3D* model;
+    gps::TransformId transform;
+    //simplified geometry hiding the objects behind it, NULL when the object is no occluder
+    const gps::OccluderMesh* occluder;
+};
+
+gps::TransformStore transforms;
+std::vector<SceneObject> sceneObjects;
+
+//parent of everything inside the compound
+gps::TransformId compoundTransform;
+//animated objects, recomputed every frame
+gps::TransformId catTransform;
+gps::TransformId moonTransform;
+gps::TransformId rocketTransform;
+gps::TransformId cubeTransform;
+
+//world snapshot shared by all render passes of the current frame
+gps::FramePacket framePacket;
+
+//scene objects per frame preparation job
+const size_t FRAME_OBJECT_GRAIN = 128;
+
+//models load in the background, objects are drawn once their model is resident
+gps::AssetStreamer assetStreamer;
+gps::SharedContext uploadContext;
+double loadStartTime = 0.0;
+
+//occlusion culling of the main pass
+gps::OcclusionCuller occlusionCuller;
+gps::OccluderMesh wallOccluder;
+gps::OccluderMesh buildingOccluders[4];
+bool occlusionCulling = true;
+
+//--stress: extra instances of the bundled models around the compound for scaling tests,
+//added as static objects so they take the same culling and drawing path
+gps::StressSceneParams stressScene = { 0, gps::STRESS_GRID, 1, 12.0f, 56.0f };
 
 float moonOrbit = 0.0f;
 
@@ -133,16 +195,113 @@ bool playedSound = false;
 
 float lightAngle = 0.0f;
 
-float fenceOffset = 13.5f;
-float feLastX = -46.0f;
-float feLastY = 0.5f;
-float feLastZ = 15.0f;
-
+GLenum polygonMode = GL_FILL;
+
+//frame statistics, toggled on the event thread and printed by the render thread
+std::atomic<bool> showFrameStats(false);
+double lastStatsReport = 0.0;
+
+//events recorded by the GLFW callbacks, drained once per frame
+gps::InputQueue inputQueue;
+gps::InputFrame inputFrame;
+unsigned long long inputEventCount = 0;
+unsigned long long reportedInputEvents = 0;
+
+//--record, --replay: the input and delta time of every simulation step go to a file, or
+//come from one instead of the clock and the callbacks, so that runs can be repeated exactly
+gps::InputRecorder inputRecorder;
+gps::InputReplay inputReplay;
+std::string recordPath;
+std::string replayPath;
+
+//input to photon latency: a timestamp query follows the buffer swap of a frame responding
+//to input and is read back frames later, without waiting. The GPU reaching the end of the
+//frame is the earliest it can be shown, the display adds its scan out on top.
+const unsigned int LATENCY_QUERIES = 4;
+struct LatencyQuery {
+    GLuint query;
+    bool pending;
+    double inputTime;
+    //the clock and the GPU timestamp when the query was issued, to map GPU time to the clock
+    double issueTime;
+    GLint64 issueGpuTime;
+};
+LatencyQuery latencyQueries[LATENCY_QUERIES];
+double pendingInputTime = 0.0;
+unsigned long long lastLatencyFrame = 0;
+double latencySum = 0.0;
+double latencyMax = 0.0;
+unsigned int latencyCount = 0;
+
+//--render-thread: the GL context lives on a render thread, the main thread handles
+//the window events and simulates at a fixed rate
+bool useRenderThread = false;
+const double SIMULATION_STEP = 1.0 / 60.0;
+std::atomic<bool> renderThreadRunning(false);
+gps::TripleBuffer<gps::FramePacket> packetBuffer;
+
+//--headless: offscreen rendering of a fixed number of frames, without a window or input
+unsigned int headlessFrames = 0;
+//--headless-size, the window size otherwise
+int headlessWidth = 1920;
+int headlessHeight = 1080;
+
+//--bench-e2e: headless replay of a recorded camera path through the whole scene, with
+//frame time percentiles and every goldenInterval-th frame compared with --golden images.
+//benchmarks/camera_path.rec is the bundled path, benchmarks/golden its frames at 480x270
+//on Mesa llvmpipe
+gps::GoldenImages goldenImages;
+std::string goldenDirectory;
+unsigned int goldenInterval = 30;
+double goldenTolerance = 2.0;
+bool updateGolden = false;
+
+//--capture, --capture-pipe: every presented frame is read back asynchronously and written
+//by a background thread
+gps::FrameCapture frameCapture;
+gps::CAPTURE_OUTPUT captureOutput = gps::CAPTURE_PPM_SEQUENCE;
+std::string captureTarget;
+
+//render passes: per pass CPU and GPU times of the frames drawn on the context thread,
+//printed with the frame statistics; F3 shows them on screen, --profile-csv writes the
+//totals at exit. Debug builds also count the GL calls per pass, toggled with F4 or --gl-stats
+gps::FrameProfiler profiler;
+unsigned int profileFrame;
+unsigned int profileShadowMap;
+unsigned int profileMainPass;
+unsigned int profileLightCube;
+unsigned int profileSkyBox;
+unsigned int profileCapture;
+std::atomic<bool> showProfilerOverlay(false);
+std::string profileCsvPath;
+
+//--bench-suite: microbenchmarks, see BenchmarkSuite.hpp
+bool runSuite = false;
+std::string benchmarkJsonPath;
+std::string benchmarkFilter;
+
+//--trace: loading, startup and every frame on a timeline, see Trace.hpp
+std::string tracePath;
+
+//--startup-json: time to a loaded scene per phase, asset and kind of work, see StartupReport.hpp
+std::string startupReportPath;
+
+//GPU and CPU memory per asset, see MemoryTracker.hpp: F5 prints it, --memory-report at exit
+bool memoryReport = false;
+
+//--alloc-check: frames counted once the scene is loaded, after some warm up frames that
+//let every container reach its steady size
+unsigned int allocationCheckFrames = 0;
+const unsigned int ALLOCATION_CHECK_WARMUP = 60;
+
+//glGetError waits for the driver on many implementations, so release builds rely on the
+//debug output (see GLDebug.hpp) and only debug builds poll it
+#ifndef NDEBUG
 GLenum glCheckError_(const char *file, int line)
 {
 	GLenum errorCode;
 	while ((errorCode = glGetError()) != GL_NO_ERROR) {
-		std::string error;
+		const char *error = "";
 		switch (errorCode) {
             case GL_INVALID_ENUM:
                 error = "INVALID_ENUM";
@@ -171,24 +330,64 @@ GLenum glCheckError_(const char *file, int line)
 	return errorCode;
 }
 #define glCheckError() glCheckError_(__FILE__, __LINE__)
+#else
+#define glCheckError() GL_NO_ERROR
+#endif
 
 void windowResizeCallback(GLFWwindow* window, int width, int height) {
 	fprintf(stdout, "Window resized! New width: %d , and height: %d\n", width, height);
 
     projection = glm::perspective(glm::radians(fieldOfView), (float)width / (float)height, 0.1f, 1000.0f);
-    projectionLoc = glGetUniformLocation(myBasicShader.shaderProgram, "projection");
-    glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
 }
 
 void updatePerspective() {
     projection = glm::perspective(glm::radians(fieldOfView), (float)myWindow.getWindowDimensions().width / (float)myWindow.getWindowDimensions().height, 0.1f, 1000.0f);
-    projectionLoc = glGetUniformLocation(myBasicShader.shaderProgram, "projection");
-    glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+}
+
+//callbacks only record the event, it is applied by processInputEvents at the next frame
+void pushInput(gps::INPUT_EVENT_TYPE type, int key, int action, double x, double y) {
+    gps::InputEvent event = { type, key, action, x, y, gps::Window::getTime() };
+    inputQueue.push(event);
 }
 
 void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int mode) {
+    pushInput(gps::INPUT_KEY, key, action, 0.0, 0.0);
+}
+
+void mouseCallback(GLFWwindow* window, double xpos, double ypos) {
+    pushInput(gps::INPUT_CURSOR, 0, 0, xpos, ypos);
+}
+
+void scrollCallback(GLFWwindow* window, double xoffset, double yoffset) {
+    pushInput(gps::INPUT_SCROLL, 0, 0, xoffset, yoffset);
+}
+
+void applyKey(int key, int action) {
 	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
-        glfwSetWindowShouldClose(window, GL_TRUE);
+        myWindow.Close();
+    }
+
+    if (key == GLFW_KEY_F1 && action == GLFW_PRESS) {
+        showFrameStats = !showFrameStats;
+    }
+
+    if (key == GLFW_KEY_F2 && action == GLFW_PRESS) {
+        occlusionCulling = !occlusionCulling;
+    }
+
+    if (key == GLFW_KEY_F3 && action == GLFW_PRESS) {
+        showProfilerOverlay = !showProfilerOverlay;
+        if (showProfilerOverlay) {
+            profiler.printLegend(std::cout);
+        }
+    }
+
+    if (key == GLFW_KEY_F4 && action == GLFW_PRESS) {
+        gps::glStats.setEnabled(!gps::glStats.isEnabled());
+    }
+
+    if (key == GLFW_KEY_F5 && action == GLFW_PRESS) {
+        gps::MemoryTracker::shared().printReport(std::cout, true);
     }
 
 	if (key >= 0 && key < 1024) {
@@ -200,11 +399,7 @@ void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int
     }
 }
 
-void mouseCallback(GLFWwindow* window, double xpos, double ypos) {
-    if (pause) {
-        return;
-    }
-
+void applyCursor(double xpos, double ypos) {
     if (firstMouse) { //set xoffset and yoffset to 0 for the same effect
         lastX = xpos;
         lastY = ypos;
@@ -228,18 +423,9 @@ void mouseCallback(GLFWwindow* window, double xpos, double ypos) {
         pitch = -89.0f;
 
     myCamera.rotate(pitch, yaw);
-
-    view = myCamera.getViewMatrix();
-    myBasicShader.useShaderProgram();
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
 }
 
-void scrollCallback(GLFWwindow* window, double xoffset, double yoffset) {
-    if (pause) {
-        return;
-    }
-
+void applyScroll(double yoffset) {
     if (fieldOfView >= 1.0f && fieldOfView <= 45.0f)
         fieldOfView -= yoffset;
     if (fieldOfView <= 1.0f)
@@ -247,15 +433,68 @@ void scrollCallback(GLFWwindow* window, double xoffset, double yoffset) {
     if (fieldOfView >= 45.0f)
         fieldOfView = 45.0f;
 
-    view = myCamera.getViewMatrix();
-    myBasicShader.useShaderProgram();
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
-
     updatePerspective();
 }
 
+void calculateDeltaTime() {
+    float currentFrame = gps::Window::getTime();
+    deltaTime = currentFrame - lastFrame;
+    lastFrame = currentFrame;
+}
+
+//the delta time and input of this simulation step: from the clock and the callbacks, or
+//the next recorded step when replaying; recorded when recording
+void readInputStep() {
+    if (inputReplay.isOpen()) {
+        if (!inputReplay.next(deltaTime, inputFrame)) {
+            //the replay is over, the scene stands still until the loop ends
+            deltaTime = 0.0f;
+            inputFrame.keys.clear();
+            inputFrame.cursorMoved = false;
+            inputFrame.scrolled = false;
+            inputFrame.firstEventTime = 0.0;
+            inputFrame.eventCount = 0;
+            myWindow.Close();
+            return;
+        }
+    }
+    else {
+        calculateDeltaTime();
+        inputQueue.drain(inputFrame);
+    }
+
+    if (inputRecorder.isOpen()) {
+        inputRecorder.record(deltaTime, inputFrame);
+    }
+}
+
+//applies everything the callbacks recorded since the last frame: keys in order, then a
+//single camera rotation and zoom however many mouse events arrived
+void processInputEvents() {
+    inputEventCount += inputFrame.eventCount;
+
+    //the first event since the last frame packet starts the latency measurement
+    if (pendingInputTime == 0.0) {
+        pendingInputTime = inputFrame.firstEventTime;
+    }
+
+    for (size_t i = 0; i < inputFrame.keys.size(); i++) {
+        applyKey(inputFrame.keys[i].key, inputFrame.keys[i].action);
+    }
+
+    if (pause) {
+        return;
+    }
+    if (inputFrame.cursorMoved) {
+        applyCursor(inputFrame.cursorX, inputFrame.cursorY);
+    }
+    if (inputFrame.scrolled) {
+        applyScroll(inputFrame.scrollY);
+    }
+}
+
 void initUniforms() {
+    gps::TraceScope trace("Init uniforms", "startup");
     myBasicShader.useShaderProgram();
 
     // create model matrix for teapot
@@ -267,8 +506,6 @@ void initUniforms() {
     // send view matrix to shader
     glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
 
-    // compute normal matrix for teapot
-    normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
     normalMatrixLoc = glGetUniformLocation(myBasicShader.shaderProgram, "normalMatrix");
 
     lightDirMatrixLoc = glGetUniformLocation(myBasicShader.shaderProgram, "lightDirMatrix");
@@ -311,36 +548,18 @@ void initUniforms() {
 void processMovement() {
     if (pressedKeys[GLFW_KEY_W]) {
         myCamera.move(gps::MOVE_FORWARD, cameraSpeed);
-        //update view matrix
-        view = myCamera.getViewMatrix();
-        myBasicShader.useShaderProgram();
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-        // compute normal matrix for teapot
-        normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
     }
 
     if (pressedKeys[GLFW_KEY_S]) {
         myCamera.move(gps::MOVE_BACKWARD, cameraSpeed);
-        view = myCamera.getViewMatrix();
-        myBasicShader.useShaderProgram();
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-        normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
     }
 
     if (pressedKeys[GLFW_KEY_A]) {
         myCamera.move(gps::MOVE_LEFT, cameraSpeed);
-        view = myCamera.getViewMatrix();
-        myBasicShader.useShaderProgram();
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-        normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
     }
 
     if (pressedKeys[GLFW_KEY_D]) {
         myCamera.move(gps::MOVE_RIGHT, cameraSpeed);
-        view = myCamera.getViewMatrix();
-        myBasicShader.useShaderProgram();
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-        normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
     }
 
     if (pressedKeys[GLFW_KEY_T]) {
@@ -387,18 +606,10 @@ void processMovement() {
 
     if (pressedKeys[GLFW_KEY_SPACE]) {
         myCamera.move(gps::MOVE_UP, cameraSpeed);
-        view = myCamera.getViewMatrix();
-        myBasicShader.useShaderProgram();
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-        normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
     }
 
     if (pressedKeys[GLFW_KEY_LEFT_CONTROL]) {
         myCamera.move(gps::MOVE_DOWN, cameraSpeed);
-        view = myCamera.getViewMatrix();
-        myBasicShader.useShaderProgram();
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-        normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
     }
 
     if (pressedKeys[GLFW_KEY_LEFT_SHIFT])
@@ -411,28 +622,22 @@ void processMovement() {
         lightAngle += 1.0f;
         if (lightAngle > 360.0f)
             lightAngle -= 360.0f;
-        glm::vec3 lightDirTr = glm::vec3(glm::rotate(glm::mat4(1.0f), glm::radians(lightAngle), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::vec4(lightDir, 1.0f));
-        myBasicShader.useShaderProgram();
-        glUniform3fv(lightDirLoc, 1, glm::value_ptr(lightDirTr));
     }
 
     if (pressedKeys[GLFW_KEY_E]) {
         lightAngle -= 1.0f;
         if (lightAngle < 0.0f)
             lightAngle += 360.0f;
-        glm::vec3 lightDirTr = glm::vec3(glm::rotate(glm::mat4(1.0f), glm::radians(lightAngle), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::vec4(lightDir, 1.0f));
-        myBasicShader.useShaderProgram();
-        glUniform3fv(lightDirLoc, 1, glm::value_ptr(lightDirTr));
     }
 
     if (pressedKeys[GLFW_KEY_1]) {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        polygonMode = GL_FILL;
     }
     if (pressedKeys[GLFW_KEY_2]) {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        polygonMode = GL_LINE;
     }
     if (pressedKeys[GLFW_KEY_3]) {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_POINT);
+        polygonMode = GL_POINT;
     }
 }
 
@@ -449,6 +654,11 @@ void processPause() {
 }
 
 void initOpenGLWindow() {
+    gps::TraceScope trace("Create window", "startup");
+    if (headlessFrames > 0) {
+        myWindow.CreateHeadless(headlessWidth, headlessHeight);
+        return;
+    }
     myWindow.Create(1920, 1080, "OpenGL Project Core");
 }
 
@@ -460,6 +670,7 @@ void setWindowCallbacks() {
 }
 
 void initOpenGLState() {
+    gps::TraceScope trace("Init GL state", "startup");
 	glClearColor(0.7f, 0.7f, 0.7f, 1.0f);
 	glViewport(0, 0, myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height);
     glEnable(GL_FRAMEBUFFER_SRGB);
@@ -468,6 +679,10 @@ void initOpenGLState() {
 	glEnable(GL_CULL_FACE); // cull face
 	glCullFace(GL_BACK); // cull back face
 	glFrontFace(GL_CCW); // GL_CCW for counter clock-wise
+
+    if (!gps::glDebug.install()) {
+        std::cout << "No GL debug output, driver errors are only seen by glCheckError in debug builds" << std::endl;
+    }
 }
 
 void initializeSkyBoxFaces() {
@@ -480,35 +695,78 @@ void initializeSkyBoxFaces() {
 }
 
 void initShaders() {
+    gps::TraceScope trace("Init shaders", "startup");
 	myBasicShader.loadShader("shaders/basic.vert", "shaders/basic.frag");
     skyboxShader.loadShader("shaders/skyboxShader.vert", "shaders/skyboxShader.frag");
     depthMapShader.loadShader("shaders/depthMapShader.vert", "shaders/depthMapShader.frag");
     lightShader.loadShader("shaders/lightCube.vert", "shaders/lightCube.frag");
+    gps::ProgramBinaryCache::shared().printSummary(std::cout);
     skyboxShader.useShaderProgram();
 }
 
+struct ModelFile {
+    gps::Model3D* model;
+    const char* path;
+};
+
+const ModelFile modelFiles[] = {
+    { &moon, "models/moon/10467_Cratered_Moon_v2_Iterations-2.obj" },
+    { &moonBuilding1, "models/moon_building1/14008_Moon_Building_Storage_Module_v2_L1.obj" },
+    { &moonBuilding2, "models/moon_building2/14006_Moon_Building_Science_Module_v2_L1.obj" },
+    { &moonBuilding3, "models/moon_building3/14007_Moon_Building_Engineering_Module_v2_L1.obj" },
+    { &moonBuilding4, "models/moon_building4/14004_Moon_Building_Barracks_v2_L1.obj" },
+    { &moonTower, "models/moon_tower/14005_Moon_Building_Communication_Relay_Tower_v2_L1.obj" },
+    { &rocket, "models/rocket/12217_rocket_v1_l1.obj" },
+    { &cat, "models/cat/12221_Cat_v1_l3.obj" },
+    { &wall, "models/wall/wall.obj" },
+    { &stoneFloor, "models/floor/ground.obj" },
+    { &cube, "models/cube/cube.obj" },
+    { &fence, "models/fence/13078_Wooden_Post_and_Rail_Fence_v1_l3.obj" }
+};
+
+//the models stream in while the scene is drawn, see AssetStreamer; the sky box is small
+//and loaded right away
 void initModels() {
-    moon.LoadModel("models/moon/10467_Cratered_Moon_v2_Iterations-2.obj");
-    moonBuilding1.LoadModel("models/moon_building1/14008_Moon_Building_Storage_Module_v2_L1.obj");
-    moonBuilding2.LoadModel("models/moon_building2/14006_Moon_Building_Science_Module_v2_L1.obj");
-    moonBuilding3.LoadModel("models/moon_building3/14007_Moon_Building_Engineering_Module_v2_L1.obj");
-    moonBuilding4.LoadModel("models/moon_building4/14004_Moon_Building_Barracks_v2_L1.obj");
-    moonTower.LoadModel("models/moon_tower/14005_Moon_Building_Communication_Relay_Tower_v2_L1.obj");
-    rocket.LoadModel("models/rocket/12217_rocket_v1_l1.obj");
-    cat.LoadModel("models/cat/12221_Cat_v1_l3.obj");
-    wall.LoadModel("models/wall/wall.obj");
-    stoneFloor.LoadModel("models/floor/ground.obj");
-    cube.LoadModel("models/cube/cube.obj");
-    fence.LoadModel("models/fence/13078_Wooden_Post_and_Rail_Fence_v1_l3.obj");
+    gps::TraceScope trace("Start streaming", "startup");
+    std::vector<gps::StreamRequest> requests;
+    for (size_t i = 0; i < sizeof(modelFiles) / sizeof(modelFiles[0]); i++) {
+        gps::StreamRequest request = { modelFiles[i].model, modelFiles[i].path };
+        requests.push_back(request);
+    }
+
+    loadStartTime = gps::Window::getTime();
+    uploadContext = myWindow.CreateSharedContext();
+    assetStreamer.start(uploadContext, requests);
+
     mySkyBox.Load(faces);
 }
 
+//on the context thread, before drawing a frame
+void streamModels() {
+    if (assetStreamer.poll() > 0 && assetStreamer.isFinished()) {
+        std::cout << "All models resident after " << gps::Window::getTime() - loadStartTime << " s" << std::endl;
+    }
+}
+
+//makes every model resident before the first simulation step, so that a recorded or
+//replayed run does not depend on how fast the models happened to load
+void finishStreaming() {
+    gps::TraceScope trace("Finish streaming", "startup");
+    while (!assetStreamer.isFinished()) {
+        streamModels();
+        myWindow.PollEvents();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
 void initDepthMapTexture() {
+    gps::TraceScope trace("Init shadow map", "startup");
     glGenFramebuffers(1, &shadowMapFBO);
     //create depth texture for FBO
     glGenTextures(1, &depthMapTexture);
     glBindTexture(GL_TEXTURE_2D, depthMapTexture);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, 2048, 2048, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    gps::MemoryTracker::shared().trackTexture(depthMapTexture, GL_DEPTH_COMPONENT, 2048, 2048, 1, 1, "Shadow map", "depth map");
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
@@ -523,12 +781,60 @@ void initDepthMapTexture() {
     glDrawBuffer(GL_NONE);
     glReadBuffer(GL_NONE);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, myWindow.getFramebuffer());
+}
+
+//the profiler and the GL call counts number their passes alike
+unsigned int addRenderPass(const char *name) {
+    gps::glStats.addPass(name);
+    return profiler.addPass(name);
+}
+
+void beginRenderPass(unsigned int pass) {
+    if (gps::trace::isEnabled()) {
+        gps::trace::begin(profiler.getPassName(pass), "render");
+    }
+    profiler.beginPass(pass);
+    gps::glStats.beginPass(pass);
+}
+
+void endRenderPass(unsigned int pass) {
+    gps::glStats.endPass();
+    profiler.endPass(pass);
+    if (gps::trace::isEnabled()) {
+        gps::trace::end();
+    }
+}
+
+struct RenderPassScope {
+    unsigned int pass;
+
+    RenderPassScope(unsigned int pass) : pass(pass) {
+        beginRenderPass(pass);
+    }
+    ~RenderPassScope() {
+        endRenderPass(pass);
+    }
+};
+
+void initProfiler() {
+    profileFrame = addRenderPass("Frame");
+    profileShadowMap = addRenderPass("Shadow map");
+    profileMainPass = addRenderPass("Main pass");
+    profileLightCube = addRenderPass("Light cube");
+    profileSkyBox = addRenderPass("Skybox");
+    profileCapture = addRenderPass("Capture");
+    profiler.init();
+}
+
+//light position for the shadow map, rotated by lightAngle
+glm::vec3 lightDirection() {
+    return glm::vec3(glm::rotate(glm::mat4(1.0f), glm::radians(lightAngle), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::vec4(lightDir, 1.0f));
 }
 
 glm::mat4 lightSpaceTransforms() {
 
-    glm::vec3 lightDirTr = glm::vec3(glm::rotate(glm::mat4(1.0f), glm::radians(lightAngle), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::vec4(lightDir, 1.0f));
+    glm::vec3 lightDirTr = lightDirection();
     glm::mat4 lightView = glm::lookAt(lightDirTr, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
     glm::mat4 lightProjection = glm::ortho(-30.0f, 30.0f, -30.0f, 30.0f, near_plane, far_plane);
     glm::mat4 lightSpaceTrMatrix = lightProjection * lightView;
@@ -536,16 +842,16 @@ glm::mat4 lightSpaceTransforms() {
     return lightSpaceTrMatrix;
 }
 
-void bindShadows(gps::Shader &shader)
+void bindShadows(gps::Shader &shader, const gps::FramePacket &packet)
 {
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, depthMapTexture);
-    glUniform1i(glGetUniformLocation(shader.shaderProgram, "shadowMap"), 3);
+    gps::gl::activeTexture(GL_TEXTURE3);
+    gps::gl::bindTexture(GL_TEXTURE_2D, depthMapTexture);
+    gps::gl::uniform1i(glGetUniformLocation(shader.shaderProgram, "shadowMap"), 3);
 
-    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "lightSpaceTrMatrix"),
+    gps::gl::uniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "lightSpaceTrMatrix"),
         1,
         GL_FALSE,
-        glm::value_ptr(lightSpaceTransforms()));
+        glm::value_ptr(packet.lightSpaceTrMatrix));
 }
 
 //Version 4: Working
@@ -599,76 +905,6 @@ glm::mat4 positionOtherMainFence() {
     return tempModel;
 }
 
-void resetMainFence() {
-    feLastX = -46.0f;
-    feLastY = 0.5f;
-    feLastZ = 15.0f;
-}
-
-void resetOtherMainFence() {
-    feLastX = -46.0f;
-    feLastY = 0.5f;
-    feLastZ = -20.0f;
-}
-
-void resetLeftWall() {
-    wLastX = 51.5f;
-    wLastY = 2.5f;
-    wLastZ = 0.0f;
-}
-
-void resetBackWall() {
-    wLastX = 0.0f;
-    wLastY = 2.5f;
-    wLastZ = -49.0f;
-}
-
-void resetFrontWall() {
-    wLastX = 0.0f;
-    wLastY = 2.5f;
-    wLastZ = 49.0f;
-}
-
-void resetRightWall() {
-    wLastX = -48.5f;
-    wLastY = 2.5f;
-    wLastZ = 0.0f;
-}
-
-void resetLastFloor() {
-    fLastX = 1.5f;
-    fLastY = 0.5f;
-    fLastZ = 0.5f;
-}
-
-glm::mat4 positionWalls(float xOffset, float zOffset, float rX, float rY, float rZ, float angle) {
-    glm::mat4 tempModel = glm::mat4(1.0f);
-    wLastX += xOffset;
-    wLastZ += zOffset;
-    tempModel = glm::translate(glm::mat4(1.0f), glm::vec3(wLastX, wLastY, wLastZ));
-    tempModel = glm::rotate(tempModel, glm::radians(angle), glm::vec3(rX, rY, rZ));
-    return tempModel;
-}
-
-glm::mat4 positionFloors(float xOffset, float yOffset, float zOffset) {
-    glm::mat4 tempModel = glm::mat4(1.0f);
-    fLastX += xOffset;
-    fLastY += yOffset;
-    fLastZ += zOffset;
-    tempModel = glm::translate(glm::mat4(1.0f), glm::vec3(fLastX, fLastY, fLastZ));
-    return tempModel;
-}
-
-glm::mat4 positionFences(float xOffset, float zOffset, float rX, float rY, float rZ, float angle) {
-    glm::mat4 tempModel = glm::mat4(1.0f);
-    feLastX += xOffset;
-    feLastZ += zOffset;
-    tempModel = glm::translate(glm::mat4(1.0f), glm::vec3(feLastX, feLastY, feLastZ));
-    tempModel = glm::rotate(tempModel, glm::radians(angle), glm::vec3(rX, rY, rZ));
-    tempModel = glm::scale(tempModel, glm::vec3(0.05f, 0.05f, 0.05f));
-    return tempModel;
-}
-
 glm::mat4 positionCat() {
     glm::mat4 tempModel = glm::mat4(1.0f);
     tempModel = glm::translate(tempModel, glm::vec3(catX, catY, catZ));
@@ -683,7 +919,6 @@ glm::mat4 positionMoon() {
     tempModel = glm::translate(tempModel, glm::vec3(25.0f, 650.0f, 15.0f));
     tempModel = glm::scale(tempModel, glm::vec3(0.000025f, 0.000025f, 0.000025f));
     tempModel = glm::rotate(tempModel, glm::radians(moonOrbit), glm::vec3(0.0f, 1.0f, 1.0f));
-    moonOrbit += 0.1f;
     return tempModel;
 }
 
@@ -746,14 +981,6 @@ glm::mat4 positionCube() {
 
 glm::mat4 positionRocket() {
     glm::mat4 tempModel = glm::mat4(1.0f);
-    if (launch) {
-        rocketY += rocketOffset;
-        rocketOffset += 0.001f;
-        if (!playedSound) {
-            PlaySound(TEXT("rocket.wav"), NULL, SND_ASYNC);
-            playedSound = true;
-        }
-    }
     tempModel = glm::translate(tempModel, glm::vec3(rocketX, rocketY, rocketZ));
     tempModel = glm::rotate(tempModel, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
     tempModel = glm::rotate(tempModel, glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
@@ -761,218 +988,425 @@ glm::mat4 positionRocket() {
     return tempModel;
 }
 
-void applyPointLight() {
+void applyPointLight(const gps::FramePacket &packet) {
+    gps::gl::uniform3fv(pointLightSourceLoc, 1, glm::value_ptr(packet.pointLightSource));
+}
+
+//meshlet culling parameters for a scene object, in model space
+gps::MeshletCullParams meshletCullParams(const gps::FramePacket &packet, unsigned int object, bool depthMapMode) {
+    gps::MeshletCullParams params;
+    const glm::mat4 &modelMatrix = packet.worldMatrices[object];
+    glm::mat4 inverseModel = glm::inverse(modelMatrix);
 
-    pointLightSource = glm::translate(glm::mat4(1.0f), glm::vec3(-14.0f, 3.0f, -3.0f)) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-    pointLightSource = view * pointLightSource;
+    if (!depthMapMode) {
+        params.modelViewProjection = packet.projection * packet.modelViewMatrices[object];
+        params.viewPosition = glm::vec3(inverseModel * glm::vec4(packet.cameraPosition, 1.0f));
+        params.orthographic = false;
+    }
+    else {
+        //the light looks from lightDirection towards the origin
+        params.modelViewProjection = packet.lightSpaceTrMatrix * modelMatrix;
+        params.viewDirection = glm::normalize(glm::mat3(inverseModel) * -packet.lightDirection);
+        params.orthographic = true;
+    }
 
-    glUniform3fv(pointLightSourceLoc, 1, glm::value_ptr(pointLightSource));
-    glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+    return params;
 }
 
-void renderObject(gps::Shader &shader, gps::Model3D &obj3D, bool depthMapMode) {
+void renderObject(gps::Shader &shader, unsigned int object, const gps::FramePacket &packet, bool depthMapMode) {
+    const glm::mat4 &modelMatrix = packet.worldMatrices[object];
     shader.useShaderProgram();
 
     if (!depthMapMode) {
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-        normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
-        glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+        gps::gl::uniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
+        gps::gl::uniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(packet.normalMatrices[object]));
     }
     else {
-        glUniformMatrix4fv(glGetUniformLocation(depthMapShader.shaderProgram, "model"),
+        gps::gl::uniformMatrix4fv(glGetUniformLocation(depthMapShader.shaderProgram, "model"),
             1,
             GL_FALSE,
-            glm::value_ptr(model));
+            glm::value_ptr(modelMatrix));
     }
 
-    obj3D.Draw(shader);
+    sceneObjects[object].model->Draw(shader, meshletCullParams(packet, object, depthMapMode));
 }
 
-void genFloor(int n, int x, int z, gps::Shader& shader, bool depthMapMode) {
-    resetLastFloor();
-
-    for (int i = 0; i < n; i++) {
-        model = positionFloors(floorOffset * x, 0.0f, floorOffset * z);
-        renderObject(shader, stoneFloor, depthMapMode);
-    }
+gps::TransformId addObject(gps::Model3D &obj3D, gps::TransformId transform) {
+    SceneObject object;
+    object.model = &obj3D;
+    object.transform = transform;
+    object.occluder = NULL;
+    sceneObjects.push_back(object);
+    return transform;
 }
 
-void genWall(int n, int one, gps::Shader& shader, bool depthMapMode) {
-    resetLeftWall();
+//static objects are placed once, inside the compound
+gps::TransformId addStaticObject(gps::Model3D &obj3D, glm::mat4 localMatrix) {
+    return addObject(obj3D, transforms.create(localMatrix, compoundTransform));
+}
 
-    for (int i = 0; i < n; i++) {
-        model = positionWalls(0.0f, wallOffset * one, 0.0f, 1.0f, 0.0f, -90.0f);
-        renderObject(shader, wall, depthMapMode);
-    }
+gps::TransformId addStaticOccluder(gps::Model3D &obj3D, glm::mat4 localMatrix, const gps::OccluderMesh &occluder) {
+    gps::TransformId transform = addStaticObject(obj3D, localMatrix);
+    sceneObjects.back().occluder = &occluder;
+    return transform;
+}
 
-    resetBackWall();
+//n floor tiles from the main floor, stepping by (x, z) tiles
+void genFloor(int n, int x, int z) {
+    glm::vec3 start(1.5f, 0.5f, 0.5f);
+    glm::vec3 step(floorOffset * x, 0.0f, floorOffset * z);
 
-    for (int i = 0; i < n; i++) {
-        model = positionWalls(wallOffset * one, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f);
-        renderObject(shader, wall, depthMapMode);
+    for (int i = 1; i <= n; i++) {
+        addStaticObject(stoneFloor, glm::translate(glm::mat4(1.0f), start + step * (float)i));
     }
+}
 
-    resetRightWall();
-
-    for (int i = 0; i < n; i++) {
-        model = positionWalls(0.0f, wallOffset * one, 0.0f, 1.0f, 0.0f, 90.0f);
-        renderObject(shader, wall, depthMapMode);
+void genWallRow(int n, glm::vec3 start, glm::vec3 step, float angle) {
+    for (int i = 1; i <= n; i++) {
+        glm::mat4 tempModel = glm::translate(glm::mat4(1.0f), start + step * (float)i);
+        tempModel = glm::rotate(tempModel, glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f));
+        addStaticOccluder(wall, tempModel, wallOccluder);
     }
+}
 
-    resetFrontWall();
+void genWall(int n, int one) {
+    genWallRow(n, glm::vec3(51.5f, 2.5f, 0.0f), glm::vec3(0.0f, 0.0f, wallOffset * one), -90.0f);
+    genWallRow(n, glm::vec3(0.0f, 2.5f, -49.0f), glm::vec3(wallOffset * one, 0.0f, 0.0f), 0.0f);
+    genWallRow(n, glm::vec3(-48.5f, 2.5f, 0.0f), glm::vec3(0.0f, 0.0f, wallOffset * one), 90.0f);
+    genWallRow(n, glm::vec3(0.0f, 2.5f, 49.0f), glm::vec3(wallOffset * one, 0.0f, 0.0f), 180.0f);
+}
 
-    for (int i = 0; i < n; i++) {
-        model = positionWalls(wallOffset * one, 0.0f, 0.0f, 1.0f, 0.0f, 180.0f);
-        renderObject(shader, wall, depthMapMode);
+void genFenceRow(int n, glm::vec3 start, glm::vec3 step) {
+    for (int i = 1; i <= n; i++) {
+        glm::mat4 tempModel = glm::translate(glm::mat4(1.0f), start + step * (float)i);
+        tempModel = glm::rotate(tempModel, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+        tempModel = glm::scale(tempModel, glm::vec3(0.05f, 0.05f, 0.05f));
+        addStaticObject(fence, tempModel);
     }
 }
 
-void genFence(int n, int one, gps::Shader& shader, bool depthMapMode) {
-    resetMainFence();
+void genFence(int n, int one) {
+    genFenceRow(n, glm::vec3(-46.0f, 0.5f, 15.0f), glm::vec3(fenceOffset * one, 0.0f, 0.0f));
+    genFenceRow(n, glm::vec3(-46.0f, 0.5f, -20.0f), glm::vec3(fenceOffset * one, 0.0f, 0.0f));
+}
 
-    for (int i = 0; i < n; i++) {
-        model = positionFences(fenceOffset * one, 0.0f, 1.0f, 0.0f, 0.0f, -90.0f); //(x, z, rX, rY, rZ, angle) - rX = rotate around X
-        renderObject(shader, fence, depthMapMode);
-    }
+void createWall() {
+    genWall(13, 1);
+    genWall(12, -1);
+}
 
-    resetOtherMainFence();
+void createFence() {
+    genFence(7, 1);
+}
 
-    for (int i = 0; i < n; i++) {
-        model = positionFences(fenceOffset * one, 0.0f, 1.0f, 0.0f, 0.0f, -90.0f); //(x, z, rX, rY, rZ, angle) - rX = rotate around X
-        renderObject(shader, fence, depthMapMode);
+//a model standing on the floor at the origin, scaled like its bundled instances;
+//the imported ones are modelled z up
+glm::mat4 stressBase(float y, float scale, bool zUp) {
+    glm::mat4 tempModel = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, y, 0.0f));
+    if (zUp) {
+        tempModel = glm::rotate(tempModel, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
     }
+    tempModel = glm::scale(tempModel, glm::vec3(scale, scale, scale));
+    return tempModel;
 }
 
-void createWall(gps::Shader& shader, bool depthMapMode) {
-    genWall(13, 1, shader, depthMapMode);
-    genWall(12, -1, shader, depthMapMode);
+void createStressScene() {
+    gps::TraceScope trace("Stress scene", "startup");
+    gps::Model3D *models[] = { &wall, &fence, &moonBuilding1, &moonBuilding2, &moonBuilding3, &moonBuilding4, &cat };
+    const gps::OccluderMesh *occluders[] = { &wallOccluder, NULL, &buildingOccluders[0], &buildingOccluders[1],
+        &buildingOccluders[2], &buildingOccluders[3], NULL };
+    glm::mat4 baseMatrices[] = {
+        stressBase(2.5f, 1.0f, false),
+        stressBase(0.5f, 0.05f, true),
+        stressBase(0.5f, 0.025f, true),
+        stressBase(0.5f, 0.03f, true),
+        stressBase(0.5f, 0.025f, true),
+        stressBase(0.5f, 0.1f, true),
+        stressBase(0.5f, 0.05f, true)
+    };
+
+    double start = gps::Window::getTime();
+    size_t first = sceneObjects.size();
+    sceneObjects.reserve(first + stressScene.count);
+    gps::generateStressScene(stressScene, baseMatrices, sizeof(models) / sizeof(models[0]),
+        [&models, &occluders](size_t kind, const glm::mat4 &localMatrix) {
+            addStaticObject(*models[kind], localMatrix);
+            sceneObjects.back().occluder = occluders[kind];
+        });
+
+    //what every object costs in the scene and in each frame packet
+    size_t sceneBytes = sizeof(SceneObject) + 2 * sizeof(glm::mat4) + sizeof(gps::TransformId) + 1;
+    size_t packetBytes = 2 * sizeof(glm::mat4) + sizeof(glm::mat3) + sizeof(gps::BoundingBox) + 2 * sizeof(unsigned int);
+    size_t added = sceneObjects.size() - first;
+    std::cout << "Stress scene: " << added << " objects (" << (stressScene.layout == gps::STRESS_GRID ? "grid" : "random")
+        << ", " << stressScene.spacing << " m apart) in " << gps::Window::getTime() - start << " s, "
+        << added * sceneBytes / (1024.0 * 1024.0) << " MB of scene and " << added * packetBytes / (1024.0 * 1024.0)
+        << " MB per frame packet" << std::endl;
 }
 
-void createFence(gps::Shader& shader, bool depthMapMode) {
-    genFence(7, 1, shader, depthMapMode);
+void createGround() {
+    genFloor(2, 1, 0);
+    genFloor(2, -1, 0);
+    genFloor(2, 0, 1);
+    genFloor(2, 0, -1);
+    genFloor(2, -1, -1);
+    genFloor(2, 1, 1);
+    genFloor(2, -1, 1);
+    genFloor(2, 1, -1);
+    genFloor(1, 1, 2);
+    genFloor(1, 2, 1);
+    genFloor(1, -1, -2);
+    genFloor(1, -2, -1);
+    genFloor(1, -1, 2);
+    genFloor(1, -2, 1);
+    genFloor(1, 1, -2);
+    genFloor(1, 2, -1);
 }
 
-void createGround(gps::Shader& shader, bool depthMapMode) {
-    genFloor(2, 1, 0, shader, depthMapMode);
-    genFloor(2, -1, 0, shader, depthMapMode);
-    genFloor(2, 0, 1, shader, depthMapMode);
-    genFloor(2, 0, -1, shader, depthMapMode);
-    genFloor(2, -1, -1, shader, depthMapMode);
-    genFloor(2, 1, 1, shader, depthMapMode);
-    genFloor(2, -1, 1, shader, depthMapMode);
-    genFloor(2, 1, -1, shader, depthMapMode);
-    genFloor(1, 1, 2, shader, depthMapMode);
-    genFloor(1, 2, 1, shader, depthMapMode);
-    genFloor(1, -1, -2, shader, depthMapMode);
-    genFloor(1, -2, -1, shader, depthMapMode);
-    genFloor(1, -1, 2, shader, depthMapMode);
-    genFloor(1, -2, 1, shader, depthMapMode);
-    genFloor(1, 1, -2, shader, depthMapMode);
-    genFloor(1, 2, -1, shader, depthMapMode);
+//the wall is a single quad and is its own occluder, the buildings are hidden by a box
+//shrunk enough to stay inside their irregular hulls; each is built once its model streamed in
+void updateOccluders() {
+    if (wallOccluder.triangles.empty() && wall.isResident()) {
+        wallOccluder.triangles = wall.getTriangles();
+    }
+
+    gps::Model3D *buildings[] = { &moonBuilding1, &moonBuilding2, &moonBuilding3, &moonBuilding4 };
+    for (int i = 0; i < 4; i++) {
+        if (buildingOccluders[i].triangles.empty() && buildings[i]->isResident()) {
+            buildingOccluders[i] = gps::OccluderMesh::fromBox(buildings[i]->getBounds(), 0.5f);
+        }
+    }
 }
 
-void drawWorldObjects(gps::Shader shader, bool depthMapMode) {
-    model = positionCat();
-    renderObject(shader, cat, depthMapMode);
+void initScene() {
+    gps::TraceScope trace("Init scene", "startup");
+    compoundTransform = transforms.create(glm::mat4(1.0f));
+
+    addStaticObject(stoneFloor, positionMainFloor());
+    addStaticOccluder(moonBuilding1, positionMoonB1(), buildingOccluders[0]);
+    addStaticOccluder(moonBuilding2, positionMoonB2(), buildingOccluders[1]);
+    addStaticOccluder(moonBuilding3, positionMoonB3(), buildingOccluders[2]);
+    addStaticOccluder(moonBuilding3, positionMoonB3V2(), buildingOccluders[2]);
+    addStaticOccluder(moonBuilding4, positionMoonB4(), buildingOccluders[3]);
+    addStaticObject(moonTower, positionMoonT());
+    addStaticOccluder(wall, positionMainLeftWall(), wallOccluder);
+    addStaticOccluder(wall, positionMainRightWall(), wallOccluder);
+    addStaticOccluder(wall, positionMainBackWall(), wallOccluder);
+    addStaticOccluder(wall, positionMainFrontWall(), wallOccluder);
+    addStaticObject(fence, positionMainFence());
+    addStaticObject(fence, positionOtherMainFence());
+
+    createGround();
+    createWall();
+    createFence();
+    if (stressScene.count > 0) {
+        createStressScene();
+    }
 
-    model = positionMainFloor();
-    renderObject(shader, stoneFloor, depthMapMode);
+    //animated transforms go last so that per frame updates only touch the end of the store
+    catTransform = addObject(cat, transforms.create(glm::mat4(1.0f), compoundTransform));
+    rocketTransform = addObject(rocket, transforms.create(glm::mat4(1.0f), compoundTransform));
+    moonTransform = addObject(moon, transforms.create(glm::mat4(1.0f)));
+    cubeTransform = transforms.create(glm::mat4(1.0f));
+
+    transforms.update();
+}
 
-    model = positionMoon();
-    renderObject(shader, moon, depthMapMode);
+void updateAnimatedObjects() {
+    transforms.setLocal(catTransform, positionCat());
+    transforms.setLocal(moonTransform, positionMoon());
+    transforms.setLocal(rocketTransform, positionRocket());
+    transforms.setLocal(cubeTransform, positionCube());
+    transforms.update();
+}
 
-    model = positionMoonB1();
-    renderObject(shader, moonBuilding1, depthMapMode);
+//advances the animations by one frame, the only place where world state changes
+void updateSimulation() {
+    if (launch) {
+        rocketY += 2.0f * rocketOffset + 0.001f;
+        rocketOffset += 0.002f;
+        if (!playedSound) {
+#ifdef _WIN32
+            PlaySound(TEXT("rocket.wav"), NULL, SND_ASYNC);
+#endif
+            playedSound = true;
+        }
+    }
 
-    model = positionMoonB2();
-    renderObject(shader, moonBuilding2, depthMapMode);
+    moonOrbit += 0.2f;
 
-    model = positionMoonB3();
-    renderObject(shader, moonBuilding3, depthMapMode);
+    updateAnimatedObjects();
+}
 
-    model = positionMoonB3V2();
-    renderObject(shader, moonBuilding3, depthMapMode);
+void buildFramePacket(gps::FramePacket &packet) {
+    gps::TraceScope trace("Build frame packet", "frame");
+    static unsigned long long frameCount = 0;
+    packet.frameIndex = ++frameCount;
+    packet.inputTime = pendingInputTime;
+    pendingInputTime = 0.0;
+    packet.inputEvents = inputEventCount;
+    packet.polygonMode = polygonMode;
+
+    packet.view = myCamera.getViewMatrix();
+    packet.projection = projection;
+    packet.cameraPosition = myCamera.getPosition();
+
+    packet.lightDirection = lightDirection();
+    packet.lightSpaceTrMatrix = lightSpaceTransforms();
+    packet.lightDirMatrix = glm::mat3(glm::inverseTranspose(packet.view));
+    packet.pointLightSource = packet.view * glm::vec4(-14.0f, 3.0f, -3.0f, 1.0f);
+
+    packet.worldMatrices.resize(sceneObjects.size());
+    packet.worldBounds.resize(sceneObjects.size());
+    packet.modelViewMatrices.resize(sceneObjects.size());
+    packet.normalMatrices.resize(sceneObjects.size());
+    packet.lightCubeMatrix = transforms.getWorld(cubeTransform);
+
+    //the transform store is only read here, so the objects are split across jobs
+    gps::JobSystem::shared().parallelFor(sceneObjects.size(), FRAME_OBJECT_GRAIN, [&packet](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            packet.worldMatrices[i] = transforms.getWorld(sceneObjects[i].transform);
+            //objects still streaming in get empty bounds and are culled
+            if (sceneObjects[i].model->isResident()) {
+                packet.worldBounds[i] = sceneObjects[i].model->getBounds().transformed(packet.worldMatrices[i]);
+            }
+            else {
+                packet.worldBounds[i].reset();
+            }
+        }
+        gps::computeViewTransforms(packet.view, &packet.worldMatrices[begin], end - begin,
+            &packet.modelViewMatrices[begin], &packet.normalMatrices[begin]);
+    });
+}
 
-    model = positionMoonB4();
-    renderObject(shader, moonBuilding4, depthMapMode);
+void cullPass(const std::vector<gps::BoundingBox> &worldBounds, const glm::mat4 &viewProjection, gps::PassVisibility &pass) {
+    gps::Frustum frustum;
+    frustum.extract(viewProjection);
 
-    model = positionMoonT();
-    renderObject(shader, moonTower, depthMapMode);
+    pass.objects.clear();
+    for (size_t i = 0; i < worldBounds.size(); i++) {
+        if (!worldBounds[i].isEmpty() && frustum.intersectsBox(worldBounds[i])) {
+            pass.objects.push_back((unsigned int)i);
+        }
+    }
 
-    model = positionRocket();
-    renderObject(shader, rocket, depthMapMode);
+    pass.visibleCount = (unsigned int)pass.objects.size();
+    pass.culledCount = (unsigned int)(worldBounds.size() - pass.objects.size());
+    pass.occludedCount = 0;
+}
 
-    model = positionMainLeftWall();
-    renderObject(shader, wall, depthMapMode);
+//rasterizes the occluders left in the pass and drops the objects hidden behind them
+void occlusionCullPass(const gps::FramePacket &packet, gps::PassVisibility &pass) {
+    occlusionCuller.beginFrame(packet.projection * packet.view);
+    for (size_t i = 0; i < pass.objects.size(); i++) {
+        unsigned int object = pass.objects[i];
+        if (sceneObjects[object].occluder != NULL) {
+            occlusionCuller.addOccluder(*sceneObjects[object].occluder, packet.worldMatrices[object]);
+        }
+    }
+    occlusionCuller.rasterize();
 
-    model = positionMainRightWall();
-    renderObject(shader, wall, depthMapMode);
+    pass.occludedCount = occlusionCuller.cull(packet.worldBounds, pass.objects);
+    pass.visibleCount = (unsigned int)pass.objects.size();
+}
 
-    model = positionMainBackWall();
-    renderObject(shader, wall, depthMapMode);
+void cullMainPass(gps::FramePacket &packet) {
+    cullPass(packet.worldBounds, packet.projection * packet.view, packet.mainPass);
 
-    model = positionMainFrontWall();
-    renderObject(shader, wall, depthMapMode);
+    packet.occlusionCulling = occlusionCulling;
+    if (occlusionCulling) {
+        occlusionCullPass(packet, packet.mainPass);
+    }
+    packet.occlusion = occlusionCuller.getStats();
+}
 
-    model = positionMainFence();
-    renderObject(shader, fence, depthMapMode);
+//frustum culling of the scene objects against the camera and the light,
+//then occlusion culling for the camera (the shadow map needs every caster in the light frustum);
+//the two passes only write their own visibility lists and run as sibling jobs
+void cullFramePacket(gps::FramePacket &packet) {
+    gps::TraceScope trace("Cull", "frame");
+    gps::JobSystem &jobs = gps::JobSystem::shared();
+    gps::FramePacket *target = &packet;
+
+    gps::Job *passes = jobs.create([] {});
+    jobs.run(jobs.create([target] { cullMainPass(*target); }, passes));
+    jobs.run(jobs.create([target] { cullPass(target->worldBounds, target->lightSpaceTrMatrix, target->shadowPass); }, passes));
+    jobs.run(passes);
+    jobs.wait(passes);
+}
 
-    model = positionOtherMainFence();
-    renderObject(shader, fence, depthMapMode);
+void drawWorldObjects(gps::Shader &shader, const gps::FramePacket &packet, bool depthMapMode) {
+    const gps::PassVisibility &pass = depthMapMode ? packet.shadowPass : packet.mainPass;
 
-    createGround(shader, depthMapMode);
-    createWall(shader, depthMapMode);
-    createFence(shader, depthMapMode);
+    for (size_t i = 0; i < pass.objects.size(); i++) {
+        unsigned int object = pass.objects[i];
+        renderObject(shader, object, packet, depthMapMode);
+    }
 }
 
-void drawLightCube(gps::Shader shader, bool depthMapMode) {
+void drawLightCube(gps::Shader &shader, const gps::FramePacket &packet) {
+    if (!cube.isResident()) {
+        return;
+    }
     shader.useShaderProgram();
-    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
-    model = positionCube();
-    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+    gps::gl::uniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(packet.projection));
+    gps::gl::uniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(packet.view));
+    gps::gl::uniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(packet.lightCubeMatrix));
     cube.Draw(shader);
 }
 
-void renderDepthMap() {
+void renderDepthMap(const gps::FramePacket &packet) {
+    RenderPassScope scope(profileShadowMap);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     depthMapShader.useShaderProgram();
-    glUniformMatrix4fv(glGetUniformLocation(depthMapShader.shaderProgram, "lightSpaceTrMatrix"),
+    gps::gl::uniformMatrix4fv(glGetUniformLocation(depthMapShader.shaderProgram, "lightSpaceTrMatrix"),
         1,
         GL_FALSE,
-        glm::value_ptr(lightSpaceTransforms()));
-    glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
+        glm::value_ptr(packet.lightSpaceTrMatrix));
+    gps::gl::bindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
     glClear(GL_DEPTH_BUFFER_BIT);
 
-    drawWorldObjects(depthMapShader, true);
+    drawWorldObjects(depthMapShader, packet, true);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    gps::gl::bindFramebuffer(GL_FRAMEBUFFER, myWindow.getFramebuffer());
 }
 
-void renderScene() {
-    renderDepthMap();
+void renderScene(const gps::FramePacket &packet) {
+    static GLenum appliedPolygonMode = GL_FILL;
+    if (packet.polygonMode != appliedPolygonMode) {
+        gps::gl::polygonMode(GL_FRONT_AND_BACK, packet.polygonMode);
+        appliedPolygonMode = packet.polygonMode;
+    }
+
+    renderDepthMap(packet);
 
+    beginRenderPass(profileMainPass);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     myBasicShader.useShaderProgram();
 
-    bindShadows(myBasicShader);
+    bindShadows(myBasicShader, packet);
 
-    applyPointLight();
+    applyPointLight(packet);
 
-    view = myCamera.getViewMatrix();
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
+    gps::gl::uniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(packet.view));
+    gps::gl::uniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(packet.projection));
+    gps::gl::uniform3fv(lightDirLoc, 1, glm::value_ptr(packet.lightDirection));
 
-    lightDirMatrix = glm::mat3(glm::inverseTranspose(view));
-
-    glUniformMatrix3fv(lightDirMatrixLoc, 1, GL_FALSE, glm::value_ptr(lightDirMatrix));
+    gps::gl::uniformMatrix3fv(lightDirMatrixLoc, 1, GL_FALSE, glm::value_ptr(packet.lightDirMatrix));
 
     glViewport(0, 0, myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height);
 
-    drawWorldObjects(myBasicShader, false);
+    drawWorldObjects(myBasicShader, packet, false);
+    endRenderPass(profileMainPass);
 
-    drawLightCube(lightShader, false);
+    beginRenderPass(profileLightCube);
+    drawLightCube(lightShader, packet);
+    endRenderPass(profileLightCube);
 
-    mySkyBox.Draw(skyboxShader, view, projection);
+    beginRenderPass(profileSkyBox);
+    mySkyBox.Draw(skyboxShader, packet.view, packet.projection);
+    endRenderPass(profileSkyBox);
 }
 
 /*
@@ -1022,14 +1456,519 @@ void cleanup() {
     //cleanup code for your own data
 }
 
-void calculateDeltaTime() {
-    float currentFrame = glfwGetTime();
-    deltaTime = currentFrame - lastFrame;
-    lastFrame = currentFrame;
+//the latencies of the frames the GPU finished since the last call
+void collectInputLatency() {
+    for (unsigned int i = 0; i < LATENCY_QUERIES; i++) {
+        LatencyQuery &latencyQuery = latencyQueries[i];
+        if (!latencyQuery.pending) {
+            continue;
+        }
+        GLint available = 0;
+        glGetQueryObjectiv(latencyQuery.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            continue;
+        }
+        GLuint64 finished = 0;
+        glGetQueryObjectui64v(latencyQuery.query, GL_QUERY_RESULT, &finished);
+        latencyQuery.pending = false;
+
+        double finishedTime = latencyQuery.issueTime + (double)((GLint64)finished - latencyQuery.issueGpuTime) * 1e-9;
+        double latency = finishedTime - latencyQuery.inputTime;
+        latencySum += latency;
+        if (latency > latencyMax) {
+            latencyMax = latency;
+        }
+        latencyCount++;
+    }
+}
+
+//after the buffer swap of a frame that responded to input; a frame drawn again by the
+//render thread is only counted the first time, and frames are skipped while every query
+//is still in flight
+void recordInputLatency(const gps::FramePacket &packet) {
+    collectInputLatency();
+    if (packet.inputTime == 0.0 || packet.frameIndex == lastLatencyFrame || !showFrameStats) {
+        return;
+    }
+    lastLatencyFrame = packet.frameIndex;
+
+    LatencyQuery *latencyQuery = NULL;
+    for (unsigned int i = 0; i < LATENCY_QUERIES && latencyQuery == NULL; i++) {
+        if (!latencyQueries[i].pending) {
+            latencyQuery = &latencyQueries[i];
+        }
+    }
+    if (latencyQuery == NULL) {
+        return;
+    }
+    if (latencyQuery->query == 0) {
+        glGenQueries(1, &latencyQuery->query);
+    }
+    glQueryCounter(latencyQuery->query, GL_TIMESTAMP);
+    glGetInteger64v(GL_TIMESTAMP, &latencyQuery->issueGpuTime);
+    latencyQuery->issueTime = gps::Window::getTime();
+    latencyQuery->inputTime = packet.inputTime;
+    latencyQuery->pending = true;
+}
+
+void reportFrameStats(const gps::FramePacket &packet) {
+    double now = gps::Window::getTime();
+    if (!showFrameStats || now - lastStatsReport < 1.0) {
+        return;
+    }
+    lastStatsReport = now;
+
+    std::cout << "Frustum culling: main pass " << packet.mainPass.visibleCount << " visible / "
+        << packet.mainPass.culledCount << " culled, shadow pass " << packet.shadowPass.visibleCount
+        << " visible / " << packet.shadowPass.culledCount << " culled" << std::endl;
+    std::cout << "Occlusion culling" << (packet.occlusionCulling ? "" : " (off)") << ": " << packet.mainPass.occludedCount
+        << " hidden by " << packet.occlusion.occluders << " occluders (" << packet.occlusion.triangles << " triangles), rasterize "
+        << packet.occlusion.rasterizeMs << " ms, test " << packet.occlusion.testMs << " ms" << std::endl;
+    std::cout << "Meshlet culling: " << gps::meshletCullStats.culledPercentage() << "% of "
+        << gps::meshletCullStats.totalTriangles << " triangles culled" << std::endl;
+
+    std::cout << "Input: " << packet.inputEvents - reportedInputEvents << " events, "
+        << inputQueue.getDropped() << " dropped since start" << std::endl;
+    reportedInputEvents = packet.inputEvents;
+
+    if (frameCapture.isCapturing()) {
+        frameCapture.printStats();
+    }
+
+    profiler.printStats(std::cout);
+    gps::glStats.printStats(std::cout);
+
+    std::cout << "Input latency (" << (useRenderThread ? "render thread" : "single thread") << "): ";
+    if (latencyCount > 0) {
+        std::cout << latencySum / latencyCount * 1000.0 << " ms avg, " << latencyMax * 1000.0 << " ms max over "
+            << latencyCount << " frames" << std::endl;
+    }
+    else {
+        std::cout << "no input" << std::endl;
+    }
+    latencySum = 0.0;
+    latencyMax = 0.0;
+    latencyCount = 0;
+}
+
+//input, animation and the frame packet of the next frame, on the thread handling the window events
+void simulateFrame(gps::FramePacket &packet) {
+    gps::TraceScope trace("Simulate", "frame");
+    readInputStep();
+    processInputEvents();
+
+    if (!myWindow.isHeadless()) {
+        glfwSetInputMode(myWindow.getWindow(), GLFW_CURSOR, pause ? GLFW_CURSOR_NORMAL : GLFW_CURSOR_DISABLED);
+    }
+    if (!pause) {
+        processMovement();
+    }
+
+    processPause();
+
+    updateOccluders();
+    updateSimulation();
+    buildFramePacket(packet);
+    cullFramePacket(packet);
+}
+
+//draws a frame packet and shows it, on the thread owning the GL context
+void presentFrame(const gps::FramePacket &packet) {
+    gps::TraceScope trace("Present", "frame");
+    gps::frameArena.rewind();
+    streamModels();
+
+    gps::meshletCullStats.reset();
+    profiler.beginFrame();
+    gps::glStats.beginFrame();
+    beginRenderPass(profileFrame);
+    renderScene(packet);
+    if (frameCapture.isCapturing()) {
+        RenderPassScope scope(profileCapture);
+        frameCapture.capture(myWindow.getFramebuffer(), packet.frameIndex);
+    }
+    endRenderPass(profileFrame);
+    profiler.endFrame();
+    //after the capture, recorded frames stay clean
+    if (showProfilerOverlay) {
+        profiler.drawOverlay(myWindow.getFramebuffer(), myWindow.getWindowDimensions().height);
+    }
+    {
+        gps::TraceScope swap("Swap buffers", "frame");
+        myWindow.SwapBuffers();
+    }
+
+    recordInputLatency(packet);
+    reportFrameStats(packet);
+    gps::glDebug.poll(std::cout);
+    glCheckError();
+}
+
+//events, simulation and rendering in turn, paced by the buffer swap
+void runSingleThreaded() {
+    while (!myWindow.ShouldClose()) {
+        simulateFrame(framePacket);
+        presentFrame(framePacket);
+        myWindow.PollEvents();
+    }
+}
+
+//streams the whole scene in, then draws headlessFrames frames (or until the replay ends) and
+//reports their times; every frame waits for the GPU, as there is no buffer swap to pace it.
+//Frames selected for the golden image check are read back after they were timed, numbered
+//like the captured ones by their frame packet
+int runHeadless() {
+    while (!assetStreamer.isFinished()) {
+        simulateFrame(framePacket);
+        presentFrame(framePacket);
+    }
+    //the loading frames would skew the per pass percentiles
+    profiler.reset();
+
+    double start = gps::Window::getTime();
+    gps::TimingStats frameTimes;
+    frameTimes.reset();
+    double checkTime = 0.0;
+    for (unsigned int i = 0; i < headlessFrames && !myWindow.ShouldClose(); i++) {
+        double frameStart = gps::Window::getTime();
+        simulateFrame(framePacket);
+        presentFrame(framePacket);
+        glFinish();
+        frameTimes.add((gps::Window::getTime() - frameStart) * 1000.0);
+
+        if (goldenImages.isSelected(framePacket.frameIndex)) {
+            double checkStart = gps::Window::getTime();
+            WindowDimensions dimensions = myWindow.getWindowDimensions();
+            goldenImages.check(myWindow.getFramebuffer(), dimensions.width, dimensions.height, framePacket.frameIndex);
+            checkTime += gps::Window::getTime() - checkStart;
+        }
+    }
+    double total = gps::Window::getTime() - start - checkTime;
+
+    std::cout << "Headless: " << frameTimes.count << " frames in " << total << " s, " << frameTimes.averageMs()
+        << " ms avg, " << frameTimes.minMs << " ms min, " << frameTimes.percentileMs(0.5) << " ms p50, "
+        << frameTimes.percentileMs(0.95) << " ms p95, " << frameTimes.percentileMs(0.99) << " ms p99, "
+        << frameTimes.maxMs << " ms max" << std::endl;
+
+    if (!goldenImages.isActive()) {
+        return EXIT_SUCCESS;
+    }
+    goldenImages.printSummary();
+    return goldenImages.passed() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//streams the whole scene in, then runs allocationCheckFrames frames and fails when any
+//of them allocated; the frame loop is expected to run without touching the heap
+int runAllocationCheck() {
+    while (!assetStreamer.isFinished() && !myWindow.ShouldClose()) {
+        simulateFrame(framePacket);
+        presentFrame(framePacket);
+        myWindow.PollEvents();
+    }
+    for (unsigned int i = 0; i < ALLOCATION_CHECK_WARMUP; i++) {
+        simulateFrame(framePacket);
+        presentFrame(framePacket);
+        myWindow.PollEvents();
+    }
+
+    gps::AllocationCounts before = gps::allocationCounts();
+    for (unsigned int i = 0; i < allocationCheckFrames; i++) {
+        simulateFrame(framePacket);
+        presentFrame(framePacket);
+        myWindow.PollEvents();
+    }
+    gps::AllocationCounts after = gps::allocationCounts();
+
+    unsigned long long allocations = after.allocations - before.allocations;
+    std::cout << "Allocation check: " << allocations << " allocations (" << after.bytes - before.bytes << " bytes) and "
+        << after.frees - before.frees << " frees in " << allocationCheckFrames << " frames, frame arena "
+        << gps::frameArena.getBytesAllocated() << " bytes in " << gps::frameArena.getAllocationCount() << " allocations" << std::endl;
+    if (allocations > 0) {
+        std::cout << "Allocation check FAILED" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Allocation check passed" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+//draws the latest published packet, or the previous one again when the simulation
+//has not produced a new one yet
+void renderThreadLoop() {
+    gps::trace::setThreadName("Render");
+    myWindow.MakeCurrent();
+
+    while (renderThreadRunning) {
+        packetBuffer.update();
+        const gps::FramePacket &packet = packetBuffer.readBuffer();
+        if (packet.frameIndex == 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        presentFrame(packet);
+    }
+
+    myWindow.ReleaseCurrent();
+}
+
+//GLFW events must be handled on the main thread, so the context moves to the render thread
+//and the main thread simulates at a fixed rate, handling events while it waits for the next step
+void runWithRenderThread() {
+    myWindow.ReleaseCurrent();
+    renderThreadRunning = true;
+    std::thread renderThread(renderThreadLoop);
+
+    double nextStep = gps::Window::getTime();
+    while (!myWindow.ShouldClose()) {
+        double now = gps::Window::getTime();
+        if (now < nextStep) {
+            glfwWaitEventsTimeout(nextStep - now);
+            continue;
+        }
+        //after a stall the simulation continues from now instead of catching up
+        nextStep += SIMULATION_STEP;
+        if (nextStep < now) {
+            nextStep = now;
+        }
+
+        simulateFrame(packetBuffer.writeBuffer());
+        packetBuffer.publish();
+    }
+
+    renderThreadRunning = false;
+    renderThread.join();
+    myWindow.MakeCurrent();
+}
+
+//the matrix builders of the scene, with the store and objects rebuilt from scratch
+void addSceneBenchmarks(gps::benchmark::Suite &suite) {
+    suite.add("Scene/position/16", [] {
+        glm::mat4 (*const builders[])() = {
+            positionMainFloor, positionMainLeftWall, positionMainBackWall, positionMainFrontWall, positionMainRightWall,
+            positionMainFence, positionOtherMainFence, positionCat, positionMoon, positionMoonB1, positionMoonB2,
+            positionMoonB3, positionMoonB3V2, positionMoonB4, positionMoonT, positionCube
+        };
+        float sum = 0.0f;
+        for (size_t i = 0; i < sizeof(builders) / sizeof(builders[0]); i++) {
+            sum += builders[i]()[3][0];
+        }
+        gps::benchmark::sink = sum;
+    }, 16.0);
+
+    const int floorTiles = 10000;
+    suite.add("Scene/genFloor/10000", [] {
+        transforms.clear();
+        sceneObjects.clear();
+        compoundTransform = transforms.create(glm::mat4(1.0f));
+        genFloor(floorTiles, 1, 0);
+        transforms.update();
+    }, floorTiles);
+
+    suite.add("Scene/initScene", [] {
+        transforms.clear();
+        sceneObjects.clear();
+        initScene();
+    }, 0.0);
+}
+
+//loading and frame hot paths; the context is only there for the texture uploads and the
+//teardown of parsed models, so a hidden headless one is preferred over a window
+int runBenchmarkSuite() {
+    try {
+        myWindow.CreateHeadless(64, 64);
+    } catch (const std::exception&) {
+        try {
+            myWindow.Create(64, 64, "Benchmarks");
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<std::string> modelPaths;
+    for (size_t i = 0; i < sizeof(modelFiles) / sizeof(modelFiles[0]); i++) {
+        modelPaths.push_back(modelFiles[i].path);
+    }
+    initializeSkyBoxFaces();
+
+    gps::benchmark::Suite suite;
+    gps::benchmark::addEngineCases(suite, modelPaths, faces);
+    addSceneBenchmarks(suite);
+    suite.run(benchmarkFilter);
+
+    int status = EXIT_SUCCESS;
+    if (!benchmarkJsonPath.empty()) {
+        if (suite.writeJson(benchmarkJsonPath)) {
+            std::cout << "Benchmark results written to " << benchmarkJsonPath << std::endl;
+        }
+        else {
+            std::cerr << "Could not write " << benchmarkJsonPath << std::endl;
+            status = EXIT_FAILURE;
+        }
+    }
+    cleanup();
+    return status;
+}
+
+void printUsage(const char *program) {
+    std::cout << "usage: " << program << " [option]" << std::endl
+        << "  --bench-transforms [count]  transform store update cost (default 100000 instances)" << std::endl
+        << "  --bench-view-transforms     batched model-view and normal matrices vs glm" << std::endl
+        << "  --bench-jobs [threads]      job system scaling from 1 thread up (default all hardware threads)" << std::endl
+        << "  --bench-input               input event stress test, per event updates vs the coalescing queue" << std::endl
+        << "  --bench-suite [json file]   microbenchmarks of loading and frame hot paths, optionally written as JSON" << std::endl
+        << "  --bench-filter <text>       only the suite benchmarks whose name contains the text" << std::endl
+        << "  --stress <count>            add count instances of the bundled models around the compound" << std::endl
+        << "  --stress-layout <layout>    grid (default) or random" << std::endl
+        << "  --stress-seed <seed>        seed of the random layout (default 1)" << std::endl
+        << "  --stress-spacing <meters>   distance between instances (default 12)" << std::endl
+        << "  --render-thread             render on a separate thread, the main thread only handles events" << std::endl
+        << "  --headless [frames]         render offscreen without a window (EGL), report frame times (default 600 frames)" << std::endl
+        << "  --headless-size <w>x<h>     size of the offscreen framebuffer (default 1920x1080)" << std::endl
+        << "  --capture <directory>       write every frame as a PPM file into the directory" << std::endl
+        << "  --capture-pipe <command>    pipe every frame as raw rgb24 into the command, e.g. an encoder" << std::endl
+        << "  --record <file>             write the input and delta time of every simulation step to the file" << std::endl
+        << "  --replay <file>             simulate from a recording instead of live input, then quit" << std::endl
+        << "  --bench-e2e <file>          replay the recording headless through the whole scene, report frame time percentiles" << std::endl
+        << "  --golden <directory>        compare every n-th frame of a headless run with the PPM images in the directory" << std::endl
+        << "  --golden-every <n>          frames between the compared ones (default 30)" << std::endl
+        << "  --golden-tolerance <error>  mean error per 8 bit channel a frame may have (default 2)" << std::endl
+        << "  --update-golden             write the golden images instead of comparing" << std::endl
+        << "  --profile-csv <file>        write the per pass CPU and GPU times (min, avg, p99) to the file at exit" << std::endl
+        << "  --gl-stats                  count the draw calls and state changes per pass from the start (debug builds)" << std::endl
+        << "  --memory-report             print the GPU and CPU memory of every asset at exit (F5 prints it any time)" << std::endl
+        << "  --no-shader-cache           compile every shader instead of loading the program binaries of the last start" << std::endl
+        << "  --trace <file>              write a Chrome trace event JSON of loading and frames to the file at exit" << std::endl
+        << "  --startup-json <file>       load everything, then write the time of every startup phase and asset by kind of work" << std::endl
+        << "  --alloc-check [frames]      fail when the frame loop allocates once the scene is loaded (default 600 frames)" << std::endl
+        << "  --help                      this text" << std::endl;
 }
 
 int main(int argc, const char * argv[]) {
 
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--bench-transforms") {
+            size_t count = (i + 1 < argc) ? (size_t)atol(argv[i + 1]) : 0;
+            gps::benchmark::transformStore(count > 0 ? count : 100000);
+            return EXIT_SUCCESS;
+        }
+        if (arg == "--bench-view-transforms") {
+            gps::benchmark::viewTransforms();
+            return EXIT_SUCCESS;
+        }
+        if (arg == "--bench-jobs") {
+            unsigned int threads = (i + 1 < argc) ? (unsigned int)atoi(argv[i + 1]) : 0;
+            gps::benchmark::jobScaling(threads);
+            return EXIT_SUCCESS;
+        }
+        if (arg == "--bench-input") {
+            gps::benchmark::inputEvents();
+            return EXIT_SUCCESS;
+        }
+        if (arg == "--bench-suite") {
+            runSuite = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                benchmarkJsonPath = argv[++i];
+            }
+        }
+        if (arg == "--bench-filter" && i + 1 < argc) {
+            benchmarkFilter = argv[++i];
+        }
+        if (arg == "--stress" && i + 1 < argc) {
+            stressScene.count = (size_t)atol(argv[++i]);
+        }
+        if (arg == "--stress-layout" && i + 1 < argc) {
+            stressScene.layout = std::string(argv[++i]) == "random" ? gps::STRESS_RANDOM : gps::STRESS_GRID;
+        }
+        if (arg == "--stress-seed" && i + 1 < argc) {
+            stressScene.seed = (unsigned int)atoi(argv[++i]);
+        }
+        if (arg == "--stress-spacing" && i + 1 < argc) {
+            stressScene.spacing = (float)atof(argv[++i]);
+        }
+        if (arg == "--render-thread") {
+            useRenderThread = true;
+        }
+        if (arg == "--headless") {
+            unsigned int frames = (i + 1 < argc) ? (unsigned int)atoi(argv[i + 1]) : 0;
+            headlessFrames = frames > 0 ? frames : 600;
+        }
+        if (arg == "--headless-size" && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &headlessWidth, &headlessHeight) != 2 || headlessWidth <= 0 || headlessHeight <= 0) {
+                std::cerr << "--headless-size takes <width>x<height>, e.g. 480x270" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        if ((arg == "--capture" || arg == "--capture-pipe") && i + 1 < argc) {
+            captureOutput = arg == "--capture" ? gps::CAPTURE_PPM_SEQUENCE : gps::CAPTURE_PIPE;
+            captureTarget = argv[++i];
+        }
+        if (arg == "--record" && i + 1 < argc) {
+            recordPath = argv[++i];
+        }
+        if (arg == "--replay" && i + 1 < argc) {
+            replayPath = argv[++i];
+        }
+        if (arg == "--bench-e2e" && i + 1 < argc) {
+            //headless until the replay closes the window
+            replayPath = argv[++i];
+            headlessFrames = UINT_MAX;
+        }
+        if (arg == "--golden" && i + 1 < argc) {
+            goldenDirectory = argv[++i];
+        }
+        if (arg == "--golden-every" && i + 1 < argc) {
+            goldenInterval = (unsigned int)atoi(argv[++i]);
+        }
+        if (arg == "--golden-tolerance" && i + 1 < argc) {
+            goldenTolerance = atof(argv[++i]);
+        }
+        if (arg == "--update-golden") {
+            updateGolden = true;
+        }
+        if (arg == "--profile-csv" && i + 1 < argc) {
+            profileCsvPath = argv[++i];
+        }
+        if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        }
+        if (arg == "--startup-json" && i + 1 < argc) {
+            startupReportPath = argv[++i];
+        }
+        if (arg == "--no-shader-cache") {
+            gps::ProgramBinaryCache::shared().setEnabled(false);
+        }
+        if (arg == "--memory-report") {
+            memoryReport = true;
+        }
+        if (arg == "--gl-stats") {
+            gps::glStats.setEnabled(true);
+        }
+        if (arg == "--alloc-check") {
+            unsigned int frames = (i + 1 < argc) ? (unsigned int)atoi(argv[i + 1]) : 0;
+            allocationCheckFrames = frames > 0 ? frames : 600;
+        }
+        if (arg == "--help") {
+            printUsage(argv[0]);
+            return EXIT_SUCCESS;
+        }
+    }
+
+    if (runSuite) {
+        return runBenchmarkSuite();
+    }
+    //only headless runs are deterministic and check frames, anything else would ignore it
+    if (!goldenDirectory.empty() && (headlessFrames == 0 || allocationCheckFrames > 0)) {
+        std::cerr << "--golden needs a headless run, --headless or --bench-e2e, without --alloc-check" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    //the startup report is built from the trace
+    if (!tracePath.empty() || !startupReportPath.empty()) {
+        gps::trace::start();
+        gps::trace::setThreadName("Main");
+    }
+
     try {
         initOpenGLWindow();
     } catch (const std::exception& e) {
@@ -1041,35 +1980,99 @@ int main(int argc, const char * argv[]) {
     initOpenGLState();
 
 	initModels();
+    initScene();
 
 	initShaders();
 	initUniforms();
     initDepthMapTexture();
-    setWindowCallbacks();
+    initProfiler();
+    if (!captureTarget.empty()) {
+        WindowDimensions dimensions = myWindow.getWindowDimensions();
+        frameCapture.start(captureOutput, captureTarget, dimensions.width, dimensions.height);
+    }
+    if (!myWindow.isHeadless()) {
+        setWindowCallbacks();
+        glfwSetInputMode(myWindow.getWindow(), GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    }
 
-    glfwSetInputMode(myWindow.getWindow(), GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-    
 	glCheckError();
 
-	while (!glfwWindowShouldClose(myWindow.getWindow())) {
-        calculateDeltaTime();
+    //event times in recordings are relative to the start of the run
+    double inputTimeOrigin = gps::Window::getTime();
+    if (!replayPath.empty()) {
+        if (!inputReplay.open(replayPath, inputTimeOrigin)) {
+            std::cerr << "Could not read the input recording " << replayPath << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << "Replaying " << inputReplay.getStepCount() << " steps from " << replayPath << std::endl;
+    }
+    if (!recordPath.empty() && !inputRecorder.open(recordPath, inputTimeOrigin)) {
+        std::cerr << "Could not write the input recording " << recordPath << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (inputReplay.isOpen() || inputRecorder.isOpen()) {
+        finishStreaming();
+    }
+    if (!startupReportPath.empty()) {
+        finishStreaming();
+        gps::StartupReport startupReport;
+        startupReport.build();
+        startupReport.printSummary(std::cout);
+        if (!startupReport.writeJson(startupReportPath)) {
+            std::cerr << "Could not write the startup report " << startupReportPath << std::endl;
+        }
+        //only the startup was asked for, the frames are not traced
+        if (tracePath.empty()) {
+            gps::trace::stop();
+        }
+    }
+    if (!goldenDirectory.empty()) {
+        goldenImages.start(goldenDirectory, goldenInterval, goldenTolerance, updateGolden);
+    }
+
+    int status = EXIT_SUCCESS;
+    if (allocationCheckFrames > 0) {
+        status = runAllocationCheck();
+    }
+    else if (myWindow.isHeadless()) {
+        status = runHeadless();
+    }
+    else if (useRenderThread) {
+        runWithRenderThread();
+    }
+    else {
+        runSingleThreaded();
+    }
 
-        if (pause) {
-            glfwSetInputMode(myWindow.getWindow(), GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+    if (inputRecorder.isOpen()) {
+        std::cout << "Recorded " << inputRecorder.getStepCount() << " steps to " << recordPath << std::endl;
+        inputRecorder.close();
+    }
+    frameCapture.stop();
+    if (myWindow.isHeadless()) {
+        profiler.printPercentiles(std::cout);
+        gps::glStats.printStats(std::cout);
+    }
+    if (myWindow.isHeadless() || memoryReport) {
+        gps::MemoryTracker::shared().printReport(std::cout, memoryReport);
+    }
+    if (!profileCsvPath.empty()) {
+        if (profiler.exportCsv(profileCsvPath)) {
+            std::cout << "Profile written to " << profileCsvPath << std::endl;
         }
         else {
-            glfwSetInputMode(myWindow.getWindow(), GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-            processMovement();
+            std::cerr << "Could not write the profile " << profileCsvPath << std::endl;
         }
-
-        processPause();
-        renderScene();
-    
-        glfwPollEvents();
-        glfwSwapBuffers(myWindow.getWindow());
-        glCheckError();
-	}
+    }
+    gps::glDebug.poll(std::cout);
+    gps::glDebug.printSummary(std::cout);
+    profiler.destroy();
+    assetStreamer.stop();
+    if (!tracePath.empty() && !gps::trace::write(tracePath)) {
+        std::cerr << "Could not write the trace " << tracePath << std::endl;
+    }
+    myWindow.DestroySharedContext(uploadContext);
 
 	cleanup();
-    return EXIT_SUCCESS;
+    return status;
 }
\ No newline at end of file
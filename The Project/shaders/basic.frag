@@ -119,9 +119,9 @@ void main()
 
     //point light
     computePointLight(pointLightSource, vec3(1.0f, 0.0f, 1.0f));
-    pAmbient *= texture(diffuseTexture, fTexCoords);
-    pDiffuse *= texture(diffuseTexture, fTexCoords);
-    pSpecular *= texture(specularTexture, fTexCoords);
+    pAmbient *= texture(diffuseTexture, fTexCoords).rgb;
+    pDiffuse *= texture(diffuseTexture, fTexCoords).rgb;
+    pSpecular *= texture(specularTexture, fTexCoords).rgb;
     vec3 pointColor = min((pAmbient + (1.0f - shadow) * pDiffuse) + (1.0f - shadow) * pSpecular, 1.0f);
 
     float fogFactor = computeFog();